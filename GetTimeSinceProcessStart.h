@@ -50,6 +50,18 @@
    The default definition is:
    #define GTSPS_LOG_ERROR(str) fprintf(stderr, str)
 
+   To compile out the instrumentation, e.g. in the builds of a hot path,  define the
+   following in every file that includes this header, not only in the implementation:
+   #define GTSPS_DISABLE_INSTRUMENTATION
+   The definition must be the same in every file of the program, e.g. set on the
+   compiler command line: files compiled without it call functions that the
+   implementation compiled with it doesn't define, and the program fails to link.
+   Marks, spans, progress counters, collectors and reports turn into empty inline
+   functions, and the hooks of GTSPS_HOOK_FUNCTION into nothing. The library then
+   adds no code, no data and no static constructor to the program, other than
+   GetTimeSinceProcessStart(), StartupReady() and the features enabled with
+   GTSPS_ENABLE_* that the program calls.
+
    To test if the  library works,  temporarily insert some  known wait time  in the
    creation of a global symbol and compare against a normal run. For example:
 
@@ -69,6 +81,39 @@
    Beware the first measurement after recompiling an executable tends to be longer,
    due to caching, security scanning, and other OS checks. So, run the test several
    times.
+
+   Startup timeline
+   Once you know how long the startup takes, you want to know where the time goes.
+   Record marks and spans, from static constructors or from main(), and print them
+   on the same time scale of GetTimeSinceProcessStart():
+
+   static int initSpan = StartupSpanBegin("static init");
+   [...]
+   int main() {
+       StartupSpanEnd(initSpan);
+       StartupMark("main");
+       [...]
+       PrintStartupTimeline(stdout);
+   }
+
+   The timeline holds up to GTSPS_TIMELINE_CAPACITY events (default 1024), define
+   it before including the implementation to change it.
+
+   Asynchronous file loading
+   Programs reading many small config and asset files during init can overlap that
+   I/O with the rest of the initialization. Define GTSPS_ENABLE_ASYNC_IO along with
+   GTSPS_IMPLEMENTATION, then start the loads as early as possible:
+
+   static const char* files[] = { "config.json", "shaders.bin" };
+   static StartupFileBatch* batch = StartupLoadFilesAsync(files, 2);
+   [...]
+   size_t size;
+   const char* config = (const char*)StartupWaitForFile(batch, 0, &size);
+
+   On Linux a thread keeps up to GTSPS_ASYNC_IO_DEPTH (default 64) reads in flight
+   with io_uring,  elsewhere or when io_uring is not available up to
+   GTSPS_ASYNC_IO_THREADS (default 4) workers load the files. Each load is recorded
+   as a span on the startup timeline.
 */
 
 #pragma once
@@ -76,12 +121,81 @@
 #ifdef GTSPS_NAMESPACE
 #define GTSPS_NAMESPACE_BEGIN namespace GTSPS_NAMESPACE {
 #define GTSPS_NAMESPACE_END }
+#define GTSPS_QUALIFIED(name) GTSPS_NAMESPACE::name
 #else
 #define GTSPS_NAMESPACE_BEGIN
 #define GTSPS_NAMESPACE_END
+#define GTSPS_QUALIFIED(name) name
+#endif
+
+#ifdef __cplusplus
+#define GTSPS_EXTERN_C extern "C"
+#else
+#define GTSPS_EXTERN_C
+#endif
+
+#include <stddef.h>                 //< for size_t
+#include <stdio.h>                  //< for FILE
+#include <stdint.h>                 //< for uint64_t
+
+#ifndef GTSPS_TIMELINE_CAPACITY
+#   define GTSPS_TIMELINE_CAPACITY 1024  //< Max number of marks and spans recorded
+#endif
+#ifndef GTSPS_TIMELINE_NAMES_SIZE
+#   define GTSPS_TIMELINE_NAMES_SIZE 16384  //< Bytes reserved for names copied by the library
+#endif
+#ifndef GTSPS_MAX_TAGGED_POOLS
+#   define GTSPS_MAX_TAGGED_POOLS 64  //< Max number of pools named by StartupTagPool()
+#endif
+#ifndef GTSPS_MAX_FLUSH_HANDLERS
+#   define GTSPS_MAX_FLUSH_HANDLERS 32  //< Max number of handlers run by StartupFastExit()
+#endif
+#ifndef GTSPS_MAX_EXIT_HANDLERS
+#   define GTSPS_MAX_EXIT_HANDLERS 1024  //< Max number of teardown handlers timed in validation
+#endif
+#ifndef GTSPS_ASYNC_IO_THREADS
+#   define GTSPS_ASYNC_IO_THREADS 4  //< Max number of worker threads per file batch
+#endif
+#ifndef GTSPS_ASYNC_IO_DEPTH
+#   define GTSPS_ASYNC_IO_DEPTH 64  //< Max number of reads in flight per file batch with io_uring
+#endif
+#ifndef GTSPS_DIFF_MIN_REGRESSION
+#   define GTSPS_DIFF_MIN_REGRESSION 0.001  //< Seconds of own time a phase must grow to regress
+#endif
+#ifndef GTSPS_ZYGOTE_REQUEST_TIMEOUT_MS
+#   define GTSPS_ZYGOTE_REQUEST_TIMEOUT_MS 1000  //< Time a zygote client has to send its request
+#endif
+#ifndef GTSPS_TUNE_TIMEOUT_MS
+#   define GTSPS_TUNE_TIMEOUT_MS 60000  //< Time a program run by StartupTuneThreads() has to get ready
+#endif
+#ifndef GTSPS_INIT_ARENA_SIZE
+#   define GTSPS_INIT_ARENA_SIZE ((size_t)1 << 30)  //< Address space reserved by StartupInitAlloc()
+#endif
+#ifndef GTSPS_MAX_INIT_REGIONS
+#   define GTSPS_MAX_INIT_REGIONS 64  //< Max number of regions tagged by StartupTagInitOnly()
+#endif
+#ifndef GTSPS_MAX_PROGRESS_COUNTERS
+#   define GTSPS_MAX_PROGRESS_COUNTERS 32  //< Max number of counters created by StartupProgressCreate()
+#endif
+#ifndef GTSPS_PROGRESS_SAMPLES
+#   define GTSPS_PROGRESS_SAMPLES 256  //< Samples kept per progress counter
+#endif
+#ifndef GTSPS_PROGRESS_PERIOD_MS
+#   define GTSPS_PROGRESS_PERIOD_MS 100  //< Initial sampling period of the progress counters
+#endif
+#ifndef GTSPS_PROGRESS_MAX_MS
+#   define GTSPS_PROGRESS_MAX_MS 300000  //< Time since the process start the progress counters are sampled for at most
+#endif
+#ifndef GTSPS_LIVE_RING_THREADS
+#   define GTSPS_LIVE_RING_THREADS 128  //< Max number of threads streaming live events
 #endif
+#ifndef GTSPS_LIVE_RING_CAPACITY
+#   define GTSPS_LIVE_RING_CAPACITY 256  //< Live events buffered per thread, a power of 2
+#endif
+
+#define GTSPS_EVENT_MARK 0
+#define GTSPS_EVENT_SPAN 1
 
-#ifndef GTSPS_IMPLEMENTATION
 GTSPS_NAMESPACE_BEGIN
 
 // @brief  Measures the time passed since the process start, this accounts for any
@@ -95,9 +209,728 @@ GTSPS_NAMESPACE_BEGIN
 // @return time in seconds, or 0.0 in case of error.
 double GetTimeSinceProcessStart();
 
-GTSPS_NAMESPACE_END
+///////////////////////////////////////////////////////////////////////////////
+// Startup timeline
+
+// Resource usage attributed to an event. For spans this is the usage of the thread
+// between the begin and the end (the usage of the process on Mac OSX), for marks it
+// is the usage of the process since its start. Not collected on Windows.
+// The hardware counters, instructions, cycles and cache misses, are collected on Linux
+// when GTSPS_ENABLE_PERF_COUNTERS is defined. Unlike the rest they count the whole
+// process, for spans too: the threads inherit them, and the counts of a thread add up
+// to the process when the thread exits. They need perf_event_paranoid <= 2 and a CPU
+// that exposes them, and are 0 otherwise.
+typedef struct StartupCounters
+{
+    uint64_t minorFaults;   //< Page faults served without I/O
+    uint64_t majorFaults;   //< Page faults that required I/O
+    uint64_t readBlocks;    //< Blocks of 512 bytes read from storage
+    uint64_t writeBlocks;   //< Blocks of 512 bytes written to storage
+    uint64_t instructions;  //< Instructions retired in user space, by the process
+    uint64_t cycles;        //< CPU cycles in user space, by the process
+    uint64_t cacheMisses;   //< Last level cache misses, by the process
+    uint64_t taskClock;     //< Nanoseconds of CPU time, in user space and in the kernel
+    uint64_t contextSwitches; //< Voluntary and involuntary
+} StartupCounters;
+
+// An entry of the startup timeline.  Times are in seconds since the process start,
+// on the same scale as GetTimeSinceProcessStart().
+typedef struct StartupEvent
+{
+    const char* name;   //< Owned by the caller (marks and spans) or by the library
+    double      begin;
+    double      end;    //< Equal to begin for marks, negative while a span is open
+    int         type;   //< GTSPS_EVENT_MARK or GTSPS_EVENT_SPAN
+    int         parent; //< Index of the enclosing span on the same thread, or -1
+    int         thread; //< OS thread id of the thread recording the event
+    int         cpu;    //< CPU the thread was running on when the event began, or -1
+    StartupCounters counters;
+} StartupEvent;
+
+#ifndef GTSPS_DISABLE_INSTRUMENTATION
+// @brief  Records a point in time on the startup timeline, e.g. "config parsed".
+//         The name is stored by pointer, pass a string literal or a string that
+//         outlives the timeline.  Safe to call from any thread, including static
+//         constructors of any module.
+void StartupMark(const char* name);
+
+// @brief  Opens a span on the startup timeline. Spans opened on the same thread
+//         nest, close them in reverse order with StartupSpanEnd(). The name has
+//         the same lifetime requirement of StartupMark().
+//
+// @return the span handle, or -1 if the timeline is full.
+int StartupSpanBegin(const char* name);
+
+// @brief  Opens a span named after a code address, e.g. the function a timer or a
+//         profiler measures. Only the raw address is recorded, as a name like
+//         "0x7f3a2c01d2e0": the symbols are resolved offline from the binary records,
+//         see PrintSymbolizedStartupRecords(), so the startup never pays for the
+//         symbol tables to be read.
+//
+// @return the span handle, or -1 if the timeline is full.
+int StartupSpanBeginAt(const void* code);
+
+// @brief  Closes a span opened by StartupSpanBegin(). A handle of -1 is ignored.
+void StartupSpanEnd(int span);
+
+// @brief  Copies up to capacity events of the timeline, in the order they started.
+//         Call this once the initialization is over, spans still open have a
+//         negative end time. An event another thread is still recording is left
+//         out, with the events after it.
+//
+// @return the number of events copied.
+int GetStartupTimeline(StartupEvent* events, int capacity);
+
+// @brief  Prints the timeline as a table to the given stream, nested spans are
+//         indented under their parent.
+void PrintStartupTimeline(FILE* out);
+
+// @brief  Tells whether the current launch collects the full instrumentation. Marks
+//         and GetTimeSinceProcessStart() are always available, while spans and the
+//         resource usage of the events are only collected by sampled launches.  By
+//         default every launch is sampled, the environment variables restrict it:
+//         GTSPS_SAMPLE_RATE=0.01     samples a fraction of the launches.
+//         GTSPS_SAMPLE_BUDGET=60     samples at most this many launches per minute
+//                                    of the user on the host, shared through a token
+//                                    bucket in GTSPS_SAMPLE_BUDGET_FILE (POSIX only,
+//                                    default /dev/shm/gtsps_sample_budget_<uid>).
+//         The decision is taken once per process, at the first event. A launch that
+//         finds the bucket locked by another one is not sampled, rather than wait.
+//
+// @return 1 if the launch is sampled, 0 otherwise.
+int StartupIsSampled();
+#endif
+
+// @brief  Records the "ready" mark, the end of the startup. Diagnostics enabled by
+//         environment variables run at this point:
+//         GTSPS_NUMA_REPORT=1  prints PrintStartupNumaReport() to stderr.
+//         GTSPS_PROGRESS_REPORT=1  prints PrintStartupProgress() to stderr.
+//         GTSPS_READY_FD=3     writes the time of the mark, a double, to the file
+//                              descriptor and closes it (POSIX only, set by
+//                              StartupTuneThreads()).
+//         The progress counters take their last sample. With
+//         GTSPS_ENABLE_INIT_MEMORY it then releases the init-only memory,  see
+//         StartupReleaseInitMemory().
+//         With GTSPS_DISABLE_INSTRUMENTATION only the release of the init-only
+//         memory is left, the function does nothing without GTSPS_ENABLE_INIT_MEMORY.
+void StartupReady();
+
+///////////////////////////////////////////////////////////////////////////////
+// Progress counters
+#ifndef GTSPS_DISABLE_INSTRUMENTATION
+
+// @brief  Creates a counter of the progress of a startup phase, e.g. the bytes loaded
+//         or the items indexed, tied to the span open on the calling thread. A thread
+//         samples the counters every GTSPS_PROGRESS_PERIOD_MS, halving the rate each
+//         time the GTSPS_PROGRESS_SAMPLES samples of a counter are used up, to draw
+//         the throughput over time and predict the end of the phase. A counter takes
+//         its last sample when its span ends, or at StartupReady(), or
+//         GTSPS_PROGRESS_MAX_MS after the process start, whichever comes first. The
+//         thread exits when no counter is left to sample,  a new counter starts it
+//         again. Up to GTSPS_MAX_PROGRESS_COUNTERS counters can be created. The name
+//         has the same lifetime requirement of StartupMark(), total is the expected
+//         final value, or 0 if unknown. Launches that are not sampled, see
+//         StartupIsSampled(), don't create counters nor start the thread.
+//
+// @return the counter handle, or -1 if there are too many counters or the launch
+//         is not sampled.
+int StartupProgressCreate(const char* name, uint64_t total);
+
+// @brief  Adds to a progress counter, lock-free, from any thread. A handle of -1 is
+//         ignored.
+void StartupProgressAdd(int counter, uint64_t amount);
+
+// @brief  Prints the progress counters: the value, the average, recent and peak
+//         throughput, the expected end of the phase for counters with a total,  and
+//         the throughput curve over time since the process start. The recent rate
+//         is measured over the last tenth of the time of the counter.
+void PrintStartupProgress(FILE* out);
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Timeline files and comparison
+
+// A timeline loaded from a file, e.g. the timeline of a previous run.
+typedef struct StartupTimeline
+{
+    StartupEvent* events;
+    int           count;
+    char*         names;    //< Storage of the event names
+} StartupTimeline;
+
+#ifndef GTSPS_DISABLE_INSTRUMENTATION
+// @brief  Saves the timeline of the current process to a text file, one event per
+//         line, to compare it with other runs.
+//
+// @return 1 on success, 0 in case of error.
+int SaveStartupTimeline(const char* path);
+
+// @brief  Loads a timeline saved by SaveStartupTimeline(),  or the first process of
+//         a file written by AppendStartupRecords(). Release it with
+//         FreeStartupTimeline().
+//
+// @return 1 on success, 0 in case of error.
+int LoadStartupTimeline(const char* path, StartupTimeline* timeline);
+
+void FreeStartupTimeline(StartupTimeline* timeline);
+
+// @brief  Compares two timelines, e.g. before and after a change. Events are matched
+//         by name and nesting, and the report lists the deltas of time,  faults and
+//         I/O per phase. Phases present in only one of the timelines are reported as
+//         new or gone. The report ends with the phase whose own time, excluding the
+//         nested spans, grew the most, if it grew by GTSPS_DIFF_MIN_REGRESSION seconds
+//         or more: smaller deltas are noise.
+void PrintStartupTimelineDiff(const StartupTimeline* before, const StartupTimeline* after, FILE* out);
+
+// @brief  Saves the spans of the current process as a pprof profile (profile.proto,
+//         uncompressed), to analyze the startup with the same tools of the steady
+//         state profiles.  Each span is a sample whose stack is the chain of the
+//         enclosing spans, with its own wall time, CPU time, faults, I/O and CPU
+//         counters as values, excluding the nested spans. The profile starts at
+//         the process start and lasts until the time of the call.  On Linux the
+//         spans of StartupSpanBeginAt() are saved as addresses in the mappings of
+//         the modules, with their build-id, for pprof to symbolize them.
+//
+// @return 1 on success, 0 in case of error.
+int SaveStartupProfile(const char* path);
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Binary records
+
+// A compact binary format for the timelines of many processes. A file starts with
+// the 8 bytes "GTSPSBIN" followed by the version (uint32_t) and 4 reserved bytes,
+// then a sequence of records, each aligned to 8 bytes:
+//   StartupRecordHeader, the payload of its type, the name and its null terminator.
+// The records of a process start with a GTSPS_RECORD_PROCESS record, the parent of
+// an event is the index of the event among those of the same process.
+#define GTSPS_RECORDS_VERSION 2
+
+#define GTSPS_RECORD_PROCESS 1  //< StartupProcessRecord, followed by the modules and the events
+#define GTSPS_RECORD_MARK    2  //< StartupEventRecord
+#define GTSPS_RECORD_SPAN    3  //< StartupEventRecord
+#define GTSPS_RECORD_COUNTER 4  //< StartupCounterRecord, a sample of a progress counter named after it
+#define GTSPS_RECORD_MODULE  5  //< StartupModuleRecord, a DSO loaded in the process, named after its path (Linux)
+
+typedef struct StartupRecordHeader
+{
+    uint16_t type;
+    uint16_t nameLength;    //< Excluding the null terminator
+    uint32_t size;          //< Of the whole record, including the padding
+} StartupRecordHeader;
+
+typedef struct StartupProcessRecord
+{
+    int32_t pid;
+    int32_t eventCount;     //< Number of marks and spans following
+    double  writeTime;      //< Seconds since process start when the records were written
+} StartupProcessRecord;
+
+typedef struct StartupEventRecord
+{
+    double          begin;
+    double          end;
+    int32_t         parent;
+    int32_t         thread;
+    int32_t         cpu;
+    int32_t         reserved;
+    StartupCounters counters;
+} StartupEventRecord;
+
+typedef struct StartupCounterRecord
+{
+    double   time;          //< Seconds since process start
+    uint64_t value;
+    uint64_t total;         //< Expected final value, or 0 if unknown
+} StartupCounterRecord;
+
+typedef struct StartupModuleRecord
+{
+    uint64_t loadBase;      //< Address the module is loaded at
+    uint32_t buildIdSize;   //< Bytes of buildId in use, 0 if the module has none
+    uint8_t  buildId[20];   //< The GNU build-id, truncated to 20 bytes
+} StartupModuleRecord;
+
+// A record read from a file. The name and the data point into the file mapping and
+// stay valid until the reader is closed.
+typedef struct StartupRecord
+{
+    int         type;       //< GTSPS_RECORD_*
+    const char* name;       //< Null terminated
+    const void* data;       //< The payload, e.g. StartupEventRecord for marks and spans
+} StartupRecord;
+
+typedef struct StartupRecordReader
+{
+    const char* data;
+    size_t      size;
+    size_t      offset;
+} StartupRecordReader;
+
+#ifndef GTSPS_DISABLE_INSTRUMENTATION
+// @brief  Appends the timeline of the current process to a binary file, creating it
+//         if needed,  together with the list of the modules loaded in the process.
+//         The records are appended with a single write, under an exclusive lock of
+//         the file, so processes can share the same file.
+//
+// @return 1 on success, 0 in case of error.
+int AppendStartupRecords(const char* path);
+
+// @brief  Maps a binary file to iterate its records without copying them.
+//
+// @return 1 on success, 0 in case of error.
+int OpenStartupRecords(const char* path, StartupRecordReader* reader);
+
+// @brief  Reads the next record.
+//
+// @return 1 if a record was read, 0 at the end of the file or if the file is corrupt.
+int NextStartupRecord(StartupRecordReader* reader, StartupRecord* record);
+
+void CloseStartupRecords(StartupRecordReader* reader);
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// NUMA placement report
+#ifndef GTSPS_DISABLE_INSTRUMENTATION
+
+// @brief  Names a memory pool, so that the NUMA report details the placement of its
+//         pages. Up to GTSPS_MAX_TAGGED_POOLS pools can be tagged.
+void StartupTagPool(const char* name, const void* address, size_t size);
+
+// @brief  Reports on which NUMA nodes the memory of the process is,  per mapping and
+//         per tagged pool, and which CPUs the threads recording the timeline ran on.
+//         Call this at the end of the startup, see StartupReady().  The report only
+//         accounts for the pages that were touched. Linux only.
+void PrintStartupNumaReport(FILE* out);
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Asynchronous file loading (requires GTSPS_ENABLE_ASYNC_IO)
+
+typedef struct StartupFileBatch StartupFileBatch;
+
+// @brief  Starts loading a set of files in the background,  so that initialization
+//         code finds them in memory by the time it needs them.  Call this as early
+//         as possible,  e.g. from a static constructor,  with the list of config
+//         and asset files the program is going to read. Each load is recorded as
+//         a span on the startup timeline, named after the file path.
+//         The paths are copied, the caller doesn't need to keep them alive.
+//
+// @return the batch handle, or NULL in case of error.
+StartupFileBatch* StartupLoadFilesAsync(const char* const* paths, int count);
+
+// @brief  Waits for a file of the batch to be loaded, blocked on a condition variable.
+//         If no worker picked up the file yet, the calling thread loads it instead of
+//         waiting. The content is
+//         null terminated for convenience, and it stays valid until the batch is
+//         freed.
+//
+// @return the content of the file, or NULL in case of error.
+const void* StartupWaitForFile(StartupFileBatch* batch, int index, size_t* size);
+
+// @brief  Waits for the workers to terminate and releases the batch, including the
+//         content of the files.
+void StartupFreeFiles(StartupFileBatch* batch);
+
+///////////////////////////////////////////////////////////////////////////////
+// Embedded runtimes
+
+// @brief  Loads a shared library, e.g. an interpreter or a scripting engine,  with
+//         dlopen() or LoadLibrary() on Windows. The load, including the static init
+//         of the library, is recorded as a span on the startup timeline named after
+//         the path.
+//
+// @return the handle of the library, or NULL in case of error.
+void* StartupLoadLibrary(const char* path, int dlopenFlags);
+
+// Hooks the initialization entry point of an embedded runtime by symbol, to record
+// a span named after the symbol each time it is called. The hook takes precedence
+// over the runtime's own definition of the symbol, in the host executable or in a
+// library loaded before the runtime, and forwards to the next definition, as found
+// by dlsym(RTLD_NEXT).  This covers runtimes the host links against,  and runtimes
+// loaded with RTLD_GLOBAL whose entry points the host resolves with RTLD_DEFAULT.
+// Define the hooks in a file that doesn't include the headers of the runtime. POSIX
+// only. With GTSPS_DISABLE_INSTRUMENTATION the hooks expand to nothing, the calls go
+// straight to the runtime.
+//
+// GTSPS_HOOK_VOID_FUNCTION(Py_Initialize, (void), ())
+// GTSPS_HOOK_FUNCTION(void*, luaL_newstate, (void), ())
+// GTSPS_HOOK_FUNCTION(int, JNI_CreateJavaVM, (void** vm, void** env, void* args), (vm, env, args))
+//
+// The hooks resolve the next definition through the implementation, the file defining
+// them doesn't need <dlfcn.h>. RTLD_NEXT searches the modules loaded after the one of
+// the caller: define the hooks in the executable or library that compiles the
+// implementation.
+#if !defined(GTSPS_DISABLE_INSTRUMENTATION) && !defined(_WIN32)
+// @brief  dlsym(RTLD_NEXT, symbol) on behalf of the hooks, not meant to be called
+//         directly.
+//
+// @return the address of the next definition of the symbol, or NULL if not found.
+void* gtsps_NextSymbol(const char* symbol);
+#endif
+
+#if defined(GTSPS_DISABLE_INSTRUMENTATION)
+#define GTSPS_HOOK_FUNCTION(returnType, symbol, parameters, arguments)
+#define GTSPS_HOOK_VOID_FUNCTION(symbol, parameters, arguments)
+#elif !defined(_WIN32)
+#define GTSPS_HOOK_FUNCTION(returnType, symbol, parameters, arguments)         \
+    GTSPS_EXTERN_C returnType symbol parameters                                \
+    {                                                                          \
+        typedef returnType (*gtsps_Function) parameters;                       \
+        static gtsps_Function next = NULL;                                     \
+        if (!next)                                                             \
+            next = (gtsps_Function)GTSPS_QUALIFIED(gtsps_NextSymbol)(#symbol); \
+        int span = GTSPS_QUALIFIED(StartupSpanBegin)(#symbol);                 \
+        returnType result = next arguments;                                    \
+        GTSPS_QUALIFIED(StartupSpanEnd)(span);                                 \
+        return result;                                                         \
+    }
+
+#define GTSPS_HOOK_VOID_FUNCTION(symbol, parameters, arguments)                \
+    GTSPS_EXTERN_C void symbol parameters                                      \
+    {                                                                          \
+        typedef void (*gtsps_Function) parameters;                             \
+        static gtsps_Function next = NULL;                                     \
+        if (!next)                                                             \
+            next = (gtsps_Function)GTSPS_QUALIFIED(gtsps_NextSymbol)(#symbol); \
+        int span = GTSPS_QUALIFIED(StartupSpanBegin)(#symbol);                 \
+        next arguments;                                                        \
+        GTSPS_QUALIFIED(StartupSpanEnd)(span);                                 \
+    }
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Fork server (requires GTSPS_ENABLE_ZYGOTE, POSIX only)
 
+typedef struct StartupZygoteWorkerInfo
+{
+    int    pid;             //< Process id of the worker
+    double latency;         //< Seconds from the request to the worker being ready
+    double zygoteStartup;   //< Seconds from the start of the zygote process to serving, the
+                            //< startup the worker skips. Not a measured cold start of a new
+                            //< process, which may differ, e.g. with a cold file cache
+} StartupZygoteWorkerInfo;
+
+// @brief  The entry point of a worker, it runs in the forked process with all the
+//         state the zygote initialized.  The worker process exits when the function
+//         returns. The connection is the socket of the client that requested it.
+typedef void (*StartupZygoteWorker)(int connection, void* userData);
+
+// @brief  Turns the calling process into a zygote: call this at the end of the
+//         expensive initialization. The zygote listens on a UNIX socket and forks
+//         a worker for each request. The time since process start at this point is
+//         reported to the clients as the startup of the zygote. A client has
+//         GTSPS_ZYGOTE_REQUEST_TIMEOUT_MS to send its request after connecting, and
+//         the workers that exit are reaped as they go. Only the workers are reaped,
+//         the other children of the process are left to their owner.  The stdio
+//         buffers are flushed before each fork. The function only returns in case
+//         of error.
+//
+// @return -1 in case of error.
+int StartupZygoteServe(const char* socketPath, StartupZygoteWorker worker, void* userData);
+
+// @brief  Asks the zygote listening on socketPath for a new worker and waits for it
+//         to be ready. Compare info->latency with info->zygoteStartup to estimate
+//         how much startup time the zygote saves.
+//
+// @return the connection to the worker, or -1 in case of error.
+int StartupZygoteSpawn(const char* socketPath, StartupZygoteWorkerInfo* info);
+
+///////////////////////////////////////////////////////////////////////////////
+// Launcher (requires GTSPS_ENABLE_LAUNCHER, Linux only)
+
+// The kernel side of the startup of a program,  from the launcher's point of view.
+// The times in seconds are measured at ptrace stops,  each stop adds a few micro-
+// seconds to the phase it ends.
+typedef struct StartupExecPhases
+{
+    double fork;        //< From fork() in the launcher to the child running
+    double preExec;     //< From the child running to the execve() system call that
+                        //< succeeds, including the attempts on the other PATH entries
+    double exec;        //< From that execve() to the new image loaded (ptrace exec event)
+    double loaderEntry; //< From the image loaded to the first instruction executed in
+                        //< user space, in the dynamic loader
+    double total;       //< From fork() to the exit of the program
+    int    exitStatus;  //< As returned by waitpid()
+} StartupExecPhases;
+
+// @brief  Runs a program to completion, splitting the part of its startup that the
+//         kernel performs before GetTimeSinceProcessStart() can observe anything in
+//         the program itself: large binaries and large environments make execve()
+//         take milliseconds. argv[0] is searched in PATH.
+//
+// @return 1 on success, 0 in case of error.
+int StartupLaunch(char* const argv[], StartupExecPhases* phases);
+
+// @brief  Finds the size of the init thread pool of a program that minimizes its time
+//         to ready. The program reads the thread count from the environment variable
+//         and calls StartupReady() at the end of its startup, then it is killed,  as
+//         it is if it doesn't get ready within GTSPS_TUNE_TIMEOUT_MS.  The variable
+//         is set in the environment of the program only, not of the caller.  It
+//         runs `runs` times for each thread count from minThreads to maxThreads,  in
+//         steps of 1.33x and 1.5x (1, 2, 3, 4, 6, 8, 12, ...), and the report lists the
+//         median time to ready, its median absolute deviation and the gain over the
+//         previous count, the curve of the diminishing returns.
+//
+// @return the thread count with the lowest median time, 0 in case of error.
+int StartupTuneThreads(char* const argv[], const char* variable, int minThreads, int maxThreads, int runs,
+                       FILE* out);
+
+///////////////////////////////////////////////////////////////////////////////
+// Fast exit (requires GTSPS_ENABLE_FAST_EXIT)
+
+typedef void (*StartupFlushHandler)(void* userData);
+
+// @brief  Registers a handler that StartupFastExit() runs,  e.g. to flush logs or to
+//         close files that must be complete. Handlers run in the reverse order of
+//         registration. Up to GTSPS_MAX_FLUSH_HANDLERS handlers can be registered.
+void StartupRegisterFlushHandler(StartupFlushHandler handler, void* userData);
+
+// @brief  Terminates the process skipping the teardown: runs the flush handlers and
+//         the stdio flush, then calls _exit(),  without running static destructors
+//         and atexit() handlers.
+//         With the environment variable GTSPS_FAST_EXIT_VALIDATE=1 it calls exit()
+//         instead, and reports to stderr the teardown it would have skipped: the
+//         duration of each static destructor and atexit() handler (glibc only), and
+//         the duration of the whole teardown. Handlers are reported by module path,
+//         offset and build-id, to be resolved with addr2line. The validation is
+//         compiled out with GTSPS_DISABLE_INSTRUMENTATION.
+void StartupFastExit(int exitCode);
+
+///////////////////////////////////////////////////////////////////////////////
+// Huge page text (requires GTSPS_ENABLE_HUGE_TEXT, Linux only)
+
+// @brief  Moves the executable code onto transparent huge pages to reduce the iTLB
+//         misses of large binaries. The part of the text segment aligned to 2 MB is
+//         copied into an anonymous region advised with MADV_HUGEPAGE,  which then
+//         replaces the original mapping in place. The cost is recorded as a span on
+//         the startup timeline.
+//         With GTSPS_ENABLE_HUGE_TEXT this runs from a static constructor,  unless
+//         the environment variable GTSPS_HUGE_TEXT is set to 0, so that the same
+//         binary can be benchmarked with and without it. The static constructor is
+//         compiled out with GTSPS_DISABLE_INSTRUMENTATION, call this at the start
+//         of main() instead.
+//
+// @return the number of bytes remapped, 0 if the text is too small or in case of
+//         error.
+size_t StartupRemapTextToHugePages();
+
+///////////////////////////////////////////////////////////////////////////////
+// Init-only memory (requires GTSPS_ENABLE_INIT_MEMORY, Linux only)
+
+// Place code and data used only during the startup in dedicated sections, released
+// with the rest of the init-only memory. Only the pages fully inside the sections are
+// released, of the module that includes the implementation. Released data reads back
+// its initial value, keep const data out of GTSPS_INIT_ONLY_DATA. Zero initialized
+// data goes in GTSPS_INIT_ONLY_BSS, which takes no space in the file, like .bss.
+//
+// GTSPS_INIT_ONLY_CODE static void ParseConfig(const char* path) { ... }
+// GTSPS_INIT_ONLY_DATA static int defaults[] = { 1, 2, 3 };
+// GTSPS_INIT_ONLY_BSS  static char scratch[1 << 20];
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(linux) || defined(__linux__) || defined(__LINUX__))
+#define GTSPS_INIT_ONLY_CODE __attribute__((section("gtsps_init_text"), noinline))
+#define GTSPS_INIT_ONLY_DATA __attribute__((section("gtsps_init_data")))
+#if defined(__clang__)
+// Clang gives a section of zero initialized variables the type NOBITS
+#define GTSPS_INIT_ONLY_BSS  __attribute__((section("gtsps_init_bss")))
+#elif defined(__x86_64__) || defined(__i386__)
+// GCC only knows the sections named .bss* have no content: the type is set in the
+// name, and the flags GCC appends after it are commented out
+#define GTSPS_INIT_ONLY_BSS  __attribute__((section("gtsps_init_bss,\"aw\",@nobits#")))
+#elif defined(__aarch64__)
+#define GTSPS_INIT_ONLY_BSS  __attribute__((section("gtsps_init_bss,\"aw\",@nobits//")))
+#else
+#define GTSPS_INIT_ONLY_BSS  __attribute__((section("gtsps_init_bss")))
+#endif
 #else
+#define GTSPS_INIT_ONLY_CODE
+#define GTSPS_INIT_ONLY_DATA
+#define GTSPS_INIT_ONLY_BSS
+#endif
+
+// @brief  Allocates memory used only during the startup, e.g. scratch tables. The
+//         memory comes from an arena of GTSPS_INIT_ARENA_SIZE bytes of address space,
+//         zero filled, and is unmapped all at once at the end of the startup.  Safe
+//         to call from any thread.
+//
+// @return the memory, aligned to 16 bytes, or NULL if the arena is full or released.
+void* StartupInitAlloc(size_t size);
+
+// @brief  Tags a region of memory as used only during the startup, e.g. a pool that
+//         will be reused later. Its pages are released with MADV_DONTNEED: they stay
+//         mapped and read back as zeros,  or as the file content for a file mapping.
+//         Only the pages fully inside the region are released. Up to
+//         GTSPS_MAX_INIT_REGIONS regions can be tagged.
+void StartupTagInitOnly(void* address, size_t size);
+
+// @brief  Releases the init-only memory: unmaps the arena of StartupInitAlloc(),  and
+//         releases the tagged regions and the pages of the init-only sections. The
+//         release is recorded as a span on the startup timeline. Called once by
+//         StartupReady(), later calls do nothing. With the environment variable
+//         GTSPS_INIT_MEMORY_REPORT=1 the reclaimed memory is reported to stderr.
+//
+// @return the bytes of resident memory reclaimed, as measured by /proc/self/statm.
+size_t StartupReleaseInitMemory();
+
+///////////////////////////////////////////////////////////////////////////////
+// Live event stream (requires GTSPS_ENABLE_LIVE_RING, POSIX only)
+
+// With the environment variable GTSPS_LIVE_RING=/dev/shm/your_program.live,  every
+// mark and span is also published to a file mapping, to be tailed while the startup
+// is running by another process. Each thread writes to its own single-producer,
+// single-consumer ring, with no system call: when the reader falls behind and a ring
+// is full, the events are dropped and counted. The file is created anew by the static
+// init of the program, and holds up to GTSPS_LIVE_RING_THREADS rings of
+// GTSPS_LIVE_RING_CAPACITY events. The variable is removed from the environment once
+// read, so that the programs started by this one don't replace the file.  Forked
+// children don't publish either.  A monitor reading the events is built without
+// GTSPS_DISABLE_INSTRUMENTATION.
+#define GTSPS_LIVE_MARK  0
+#define GTSPS_LIVE_BEGIN 1      //< A span begins
+#define GTSPS_LIVE_END   2      //< A span ends
+#define GTSPS_LIVE_PROGRESS 3   //< A sample of a progress counter
+
+typedef struct StartupLiveEvent
+{
+    double   time;      //< Seconds since the process start
+    uint64_t value;     //< Of a progress counter
+    uint64_t total;     //< Of a progress counter, 0 if unknown
+    int32_t  type;      //< GTSPS_LIVE_*
+    int32_t  span;      //< Index on the timeline, the same for the begin and the end of a span,
+                        //< the phase of a progress counter
+    int32_t  thread;    //< OS thread id
+    char     name[60];  //< Truncated, null terminated
+} StartupLiveEvent;
+
+typedef struct StartupLiveReader
+{
+    void*    mapping;
+    size_t   size;
+    int      pid;       //< Of the process publishing the events
+    uint64_t dropped;   //< Events dropped by the process so far, the rings being full
+} StartupLiveReader;
+
+#ifndef GTSPS_DISABLE_INSTRUMENTATION
+// @brief  Maps the live events of a process, published to GTSPS_LIVE_RING. There is a
+//         single reader per process.
+//
+// @return 1 on success, 0 if the file doesn't exist yet or is not a live event ring.
+int OpenStartupLiveRing(const char* path, StartupLiveReader* reader);
+
+// @brief  Copies up to capacity of the events published since the last poll, without
+//         waiting. The events of a thread are in order, the threads are interleaved.
+//
+// @return the number of events copied.
+int PollStartupLiveRing(StartupLiveReader* reader, StartupLiveEvent* events, int capacity);
+
+void CloseStartupLiveRing(StartupLiveReader* reader);
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Offline tools (requires GTSPS_ENABLE_OFFLINE_TOOLS, Linux only)
+
+// @brief  Prints the processes of a binary records file with the code addresses of
+//         the events, see StartupSpanBeginAt(), resolved to functions and source
+//         lines. Each address is looked up in the module it falls into by its build-
+//         id: first as <debugDirectory>/.build-id/xx/yyyy.debug, then as the module
+//         path recorded if its build-id still matches. The resolution runs addr2line
+//         from binutils, which reads the DWARF of the file.
+//         A NULL debugDirectory stands for /usr/lib/debug.
+//
+// @return 1 on success, 0 in case of error.
+#ifndef GTSPS_DISABLE_INSTRUMENTATION
+int PrintSymbolizedStartupRecords(const char* recordsPath, const char* debugDirectory, FILE* out);
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Instrumentation compiled out (GTSPS_DISABLE_INSTRUMENTATION)
+
+// The instrumentation API turns into empty inline functions that return "nothing
+// recorded": -1 handles, 0 events, 0 for failure. StartupReady() only releases the
+// init-only memory of GTSPS_ENABLE_INIT_MEMORY, it stays a function.  The spans of
+// the features enabled with GTSPS_ENABLE_*,  e.g. the loads of StartupLoadFilesAsync(),
+// are compiled out with the rest, while the features keep working.
+#ifdef GTSPS_DISABLE_INSTRUMENTATION
+static inline void StartupMark(const char* name) { (void)name; }
+static inline int StartupSpanBegin(const char* name) { (void)name; return -1; }
+static inline int StartupSpanBeginAt(const void* code) { (void)code; return -1; }
+static inline void StartupSpanEnd(int span) { (void)span; }
+static inline int GetStartupTimeline(StartupEvent* events, int capacity) { (void)events; (void)capacity; return 0; }
+static inline void PrintStartupTimeline(FILE* out) { (void)out; }
+static inline int StartupIsSampled() { return 0; }
+
+static inline int StartupProgressCreate(const char* name, uint64_t total) { (void)name; (void)total; return -1; }
+static inline void StartupProgressAdd(int counter, uint64_t amount) { (void)counter; (void)amount; }
+static inline void PrintStartupProgress(FILE* out) { (void)out; }
+
+static inline int SaveStartupTimeline(const char* path) { (void)path; return 0; }
+static inline int LoadStartupTimeline(const char* path, StartupTimeline* timeline)
+{
+    (void)path;
+    timeline->events = NULL;
+    timeline->count = 0;
+    timeline->names = NULL;
+    return 0;
+}
+static inline void FreeStartupTimeline(StartupTimeline* timeline) { (void)timeline; }
+static inline void PrintStartupTimelineDiff(const StartupTimeline* before, const StartupTimeline* after, FILE* out)
+{
+    (void)before;
+    (void)after;
+    (void)out;
+}
+static inline int SaveStartupProfile(const char* path) { (void)path; return 0; }
+
+static inline int AppendStartupRecords(const char* path) { (void)path; return 0; }
+static inline int OpenStartupRecords(const char* path, StartupRecordReader* reader)
+{
+    (void)path;
+    (void)reader;
+    return 0;
+}
+static inline int NextStartupRecord(StartupRecordReader* reader, StartupRecord* record)
+{
+    (void)reader;
+    (void)record;
+    return 0;
+}
+static inline void CloseStartupRecords(StartupRecordReader* reader) { (void)reader; }
+
+static inline void StartupTagPool(const char* name, const void* address, size_t size)
+{
+    (void)name;
+    (void)address;
+    (void)size;
+}
+static inline void PrintStartupNumaReport(FILE* out) { (void)out; }
+
+static inline int OpenStartupLiveRing(const char* path, StartupLiveReader* reader)
+{
+    (void)path;
+    (void)reader;
+    return 0;
+}
+static inline int PollStartupLiveRing(StartupLiveReader* reader, StartupLiveEvent* events, int capacity)
+{
+    (void)reader;
+    (void)events;
+    (void)capacity;
+    return 0;
+}
+static inline void CloseStartupLiveRing(StartupLiveReader* reader) { (void)reader; }
+
+static inline int PrintSymbolizedStartupRecords(const char* recordsPath, const char* debugDirectory, FILE* out)
+{
+    (void)recordsPath;
+    (void)debugDirectory;
+    (void)out;
+    return 0;
+}
+#endif
+
+GTSPS_NAMESPACE_END
+
+#ifdef GTSPS_IMPLEMENTATION
 ///////////////////////////////////////////////////////////////////////////////
 // Implementation
 
@@ -113,133 +946,4460 @@ GTSPS_NAMESPACE_END
 #   include <unistd.h>             //< for sysconf()
 #   include <stdio.h>
 #   include <stdint.h>
+#   include <time.h>               //< for clock_gettime()
+#   include <fcntl.h>              //< for open()
+#   include <sys/stat.h>           //< for fstat()
+#   include <sched.h>              //< for sched_yield()
+#   include <pthread.h>
+#   include <errno.h>
+#   include <sys/socket.h>         //< for the zygote socket
+#   include <sys/un.h>
+#   include <sys/wait.h>           //< for waitpid()
+#   include <sys/mman.h>           //< for mmap(), madvise(), mremap()
+#   include <sys/file.h>           //< for flock()
+#   include <sys/syscall.h>        //< for SYS_gettid, SYS_move_pages
+#   include <sys/resource.h>       //< for getrusage()
+#   include <sys/ptrace.h>         //< for the launcher
+#   include <poll.h>               //< for the timeout of the thread tuner
+#   include <signal.h>
+#   include <link.h>               //< for dl_iterate_phdr()
+#   include <dlfcn.h>              //< for dlopen(), dlsym()
+#   ifdef GTSPS_ENABLE_PERF_COUNTERS
+#       include <linux/perf_event.h>
+#   endif
+#   if defined(GTSPS_ENABLE_ASYNC_IO) && defined(__has_include)
+#       if __has_include(<linux/io_uring.h>)
+#           include <linux/io_uring.h>     //< for the file loads, the ring is driven with raw syscalls
+#       endif
+#   endif
 #elif defined(__APPLE__) || defined(MACOSX) || defined(__MACOSX__)
 #   include <unistd.h>             //< for getpid()
 #   include <libproc.h>
+#   include <stdint.h>
+#   include <sys/time.h>           //< for gettimeofday()
+#   include <fcntl.h>              //< for open()
+#   include <sys/stat.h>           //< for fstat()
+#   include <sched.h>              //< for sched_yield()
+#   include <pthread.h>
+#   include <errno.h>
+#   include <sys/socket.h>         //< for the zygote socket
+#   include <sys/un.h>
+#   include <sys/wait.h>           //< for waitpid()
+#   include <sys/resource.h>       //< for getrusage()
+#   include <sys/mman.h>           //< for mmap()
+#   include <sys/file.h>           //< for flock()
+#   include <dlfcn.h>              //< for dlopen(), dlsym()
+#endif
+#include <stdlib.h>                 //< for malloc()
+#include <string.h>                 //< for strlen(), memcpy()
+
+// The implementation sticks to the interfaces the C library declares by default,
+// so that the includer doesn't need _GNU_SOURCE before its first system header. The
+// few Linux extensions declared only with _GNU_SOURCE go through syscall(), or are
+// declared here with their stable ABI.
+#if !defined(_WIN32) && !defined(RTLD_NEXT)
+#   define RTLD_NEXT ((void*)-1l)
+#endif
+#if defined(linux) || defined(__linux__) || defined(__LINUX__)
+#   ifndef MREMAP_MAYMOVE
+#       define MREMAP_MAYMOVE 1
+#   endif
+#   ifndef MREMAP_FIXED
+#       define MREMAP_FIXED 2
+#   endif
+extern char** environ;
+
+// The loaded modules, as reported by dl_iterate_phdr(). glibc declares both only
+// with _GNU_SOURCE, the leading fields are the same since the first version.
+#   if defined(__GLIBC__) && !defined(__USE_GNU)
+typedef struct gtsps_ModuleInfo
+{
+    ElfW(Addr)        dlpi_addr;
+    const char*       dlpi_name;
+    const ElfW(Phdr)* dlpi_phdr;
+    ElfW(Half)        dlpi_phnum;
+} gtsps_ModuleInfo;
+GTSPS_EXTERN_C int dl_iterate_phdr(int (*callback)(gtsps_ModuleInfo* info, size_t size, void* data), void* data);
+#   else
+typedef struct dl_phdr_info gtsps_ModuleInfo;
+#   endif
 #endif
 
 #ifdef GTSPS_DONT_LOG_ERRORS
-#    define GTSPS_LOG_ERROR(str)
+#    define GTSPS_LOG_ERROR(str) ((void)0)
 #elif ! defined(GTSPS_LOG_ERROR)
 #    define GTSPS_LOG_ERROR(str) fprintf(stderr, str)
 #    include <stdio.h>
 #endif
 
+// The timeline is written concurrently by any thread, including static constructors
+// running before main(). Use the atomics of the language the implementation is
+// compiled with.
+#ifdef __cplusplus
+#   include <atomic>
+#   define GTSPS_ATOMIC(type)              std::atomic<type>
+#   define GTSPS_ATOMIC_LOAD(ptr)          std::atomic_load_explicit(ptr, std::memory_order_acquire)
+#   define GTSPS_ATOMIC_STORE(ptr, value)  std::atomic_store_explicit(ptr, value, std::memory_order_release)
+#   define GTSPS_ATOMIC_FETCH_ADD(ptr, value) std::atomic_fetch_add_explicit(ptr, value, std::memory_order_relaxed)
+#   define GTSPS_ATOMIC_CAS(ptr, expected, desired) \
+        std::atomic_compare_exchange_strong_explicit(ptr, expected, desired, std::memory_order_acq_rel, std::memory_order_acquire)
+#   define GTSPS_THREAD_LOCAL thread_local
+#else
+#   include <stdatomic.h>
+#   define GTSPS_ATOMIC(type)              _Atomic(type)
+#   define GTSPS_ATOMIC_LOAD(ptr)          atomic_load_explicit(ptr, memory_order_acquire)
+#   define GTSPS_ATOMIC_STORE(ptr, value)  atomic_store_explicit(ptr, value, memory_order_release)
+#   define GTSPS_ATOMIC_FETCH_ADD(ptr, value) atomic_fetch_add_explicit(ptr, value, memory_order_relaxed)
+#   define GTSPS_ATOMIC_CAS(ptr, expected, desired) \
+        atomic_compare_exchange_strong_explicit(ptr, expected, desired, memory_order_acq_rel, memory_order_acquire)
+#   if defined(_MSC_VER)
+#       define GTSPS_THREAD_LOCAL __declspec(thread)
+#   else
+#       define GTSPS_THREAD_LOCAL _Thread_local
+#   endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#   define GTSPS_MAYBE_UNUSED __attribute__((unused))
+#else
+#   define GTSPS_MAYBE_UNUSED
+#endif
+
 GTSPS_NAMESPACE_BEGIN
 
-double GetTimeSinceProcessStart()
+// @brief  Reads the process start time, in seconds, on the time scale returned by
+//         gtsps_ReadClock().
+//
+// @return time in seconds, or 0.0 in case of error.
+static double gtsps_ReadProcessStartTime()
 {
 #if defined(_WIN32)
-    double startTime = 0.0;
-    {
-        FILETIME creationTime, exitTime, kernelTime, userTime;
-        if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
-        {
-            GTSPS_LOG_ERROR("Error: Failed to call GetProcessTimes\n");
-            return 0.0;
-        }
-
-        ULARGE_INTEGER converter;
-        converter.LowPart = creationTime.dwLowDateTime;
-        converter.HighPart = creationTime.dwHighDateTime;
-        startTime = (double)converter.QuadPart / 10000000.0; // Convert 100-ns intervals to seconds
-    }
-
-    double currentTime = 0.0;
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
     {
-        FILETIME systemTime;
-        GetSystemTimeAsFileTime(&systemTime); // Current time
-
-        ULARGE_INTEGER converter;
-        converter.LowPart = systemTime.dwLowDateTime;
-        converter.HighPart = systemTime.dwHighDateTime;
-        currentTime = (double)converter.QuadPart / 10000000.0; // Convert 100-ns intervals to seconds
+        GTSPS_LOG_ERROR("Error: Failed to call GetProcessTimes\n");
+        return 0.0;
     }
 
-    double timeInSeconds = currentTime - startTime;
-    return timeInSeconds;
+    ULARGE_INTEGER converter;
+    converter.LowPart = creationTime.dwLowDateTime;
+    converter.HighPart = creationTime.dwHighDateTime;
+    return (double)converter.QuadPart / 10000000.0; // Convert 100-ns intervals to seconds
 
 #elif defined(linux) || defined(__linux__) || defined(__LINUX__)
-    double processStartTimeInSeconds = 0.0;
-    if (FILE* file = fopen("/proc/self/stat", "r"))
-    {
-        // Start time is the 22nd field (https://man7.org/linux/man-pages/man5/proc_pid_stat.5.html)
-        uint64_t startTime = 0;
-        int decoded = fscanf(file, "%*s (%*s %*s %*s %*s %*s %*s %*s %*s %*s %*s "
-                                   "%*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %zu",
-                             &startTime);
-        fclose(file);
-        if (decoded != 1)
-        {
-            GTSPS_LOG_ERROR("Error: Failed decoding /proc/self/stat.\n");
-            return 0.0;
-        }
-
-        // Thypically this is 100Hz, it has nothing to do with CPU clock, rather with
-        // interrupts and how the OS probes the process and increment timers. It gives
-        // this measurement a resolution of 10 ms.
-        double clockTicksPerSecond = (double)sysconf(_SC_CLK_TCK); 
-
-        // Read start time in clock ticks (since kernel start time), convert it to seconds
-        processStartTimeInSeconds = (double)startTime / clockTicksPerSecond;
+    // Read with open() into a buffer on the stack rather than with stdio: this often
+    // runs before main(), and the measurement must not allocate memory itself.
+    char stat[1024];
+    ssize_t size = -1;
+    int fd = open("/proc/self/stat", O_RDONLY | O_CLOEXEC);
+    if (fd >= 0)
+    {
+        size = read(fd, stat, sizeof(stat) - 1);
+        close(fd);
     }
-    else
+    if (size <= 0)
     {
         GTSPS_LOG_ERROR("Error: Failed to open /proc/self/stat.\n");
         return 0.0;
     }
+    stat[size] = '\0';
 
-    double kernelUpTimeInSeconds = 0.0;
-    if (FILE* file = fopen("/proc/uptime", "r"))
+    // Start time is the 22nd field (https://man7.org/linux/man-pages/man5/proc_pid_stat.5.html)
+    // The 2nd field is the executable name in parentheses, which may contain spaces and
+    // parentheses itself, count the fields from the last closing parenthesis.
+    const char* field = strrchr(stat, ')');
+    for (int index = 2; field && index < 22; ++index)
     {
-        // Total kernel uptime in seconds is the first field
-        int decoded = fscanf(file, "%lf", &kernelUpTimeInSeconds);
-        fclose(file);
-        if (decoded != 1)
-        {
-            GTSPS_LOG_ERROR("Error: Failed decoding /proc/uptime.\n");
-            return 0.0;
-        }
+        field = strchr(field, ' ');
+        if (field)
+            ++field;
     }
-    else
+    if (!field || *field < '0' || *field > '9')
     {
-        GTSPS_LOG_ERROR("Error: Failed to open /proc/uptime.\n");
+        GTSPS_LOG_ERROR("Error: Failed decoding /proc/self/stat.\n");
         return 0.0;
     }
+    uint64_t startTime = 0;
+    for (; *field >= '0' && *field <= '9'; ++field)
+        startTime = startTime * 10 + (uint64_t)(*field - '0');
 
-    double timeInSeconds = kernelUpTimeInSeconds - processStartTimeInSeconds;
-    return timeInSeconds;
+    // Thypically this is 100Hz, it has nothing to do with CPU clock, rather with
+    // interrupts and how the OS probes the process and increment timers. It gives
+    // this measurement a resolution of 10 ms.
+    double clockTicksPerSecond = (double)sysconf(_SC_CLK_TCK); 
+
+    // Read start time in clock ticks (since kernel start time), convert it to seconds
+    return (double)startTime / clockTicksPerSecond;
 
 #elif defined(__APPLE__) || defined(MACOSX) || defined(__MACOSX__)
-    struct timeval startTime = {};
+    // Get current process info, including the startup time
+    pid_t pid = getpid();
+    struct proc_bsdinfo task_info = { 0 };
+    if (proc_pidinfo(pid, PROC_PIDTBSDINFO, 0, &task_info, sizeof(task_info)) <= 0)
     {
-        // Get current process info, including the startup time
-        pid_t pid = getpid();
-        struct proc_bsdinfo task_info = {};
-        if (proc_pidinfo(pid, PROC_PIDTBSDINFO, 0, &task_info, sizeof(task_info)) <= 0)
-        {
-            GTSPS_LOG_ERROR("Error: proc_pidinfo failed");
-            return 0.0;
-        }
-        startTime.tv_sec  = task_info.pbi_start_tvsec;
-        startTime.tv_usec = task_info.pbi_start_tvusec;
+        GTSPS_LOG_ERROR("Error: proc_pidinfo failed");
+        return 0.0;
     }
+    return (double)task_info.pbi_start_tvsec +                //< Seconds
+           (double)task_info.pbi_start_tvusec / 1000000.0;    //< Microseconds
+#else
+    #warning unsupported platform
+    return 0.0;
+#endif
+}
 
-    struct timeval currentTime = {};
-    gettimeofday(&currentTime, NULL);
+// @brief  Reads the current time,  in seconds,  from a clock that shares the origin
+//         of the process start time reported by the OS.
+static double gtsps_ReadClock()
+{
+#if defined(_WIN32)
+    FILETIME systemTime;
+#   if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+    GetSystemTimePreciseAsFileTime(&systemTime); // Current time, Windows 8 and later
+#   else
+    GetSystemTimeAsFileTime(&systemTime);        // Current time, at the resolution of the clock tick
+#   endif
 
-    double timeInSeconds = (double)(currentTime.tv_sec  - startTime.tv_sec ) +            //< Seconds
-                           (double)(currentTime.tv_usec - startTime.tv_usec) / 1000000.0; //< Microseconds
-    return timeInSeconds;
+    ULARGE_INTEGER converter;
+    converter.LowPart = systemTime.dwLowDateTime;
+    converter.HighPart = systemTime.dwHighDateTime;
+    return (double)converter.QuadPart / 10000000.0; // Convert 100-ns intervals to seconds
+
+#elif defined(linux) || defined(__linux__) || defined(__LINUX__)
+    // The boot time clock counts from the kernel start and includes suspension, same as
+    // /proc/uptime and the process start time.
+    struct timespec now;
+    clock_gettime(CLOCK_BOOTTIME, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1000000000.0;
+
+#elif defined(__APPLE__) || defined(MACOSX) || defined(__MACOSX__)
+    struct timeval currentTime = { 0 };
+    gettimeofday(&currentTime, NULL);
+    return (double)currentTime.tv_sec + (double)currentTime.tv_usec / 1000000.0;
 #else
-    #warning unsupported platform
     return 0.0;
 #endif
 }
 
+// The process start time is read once per process, then every measurement costs a
+// clock read. All the modules including the implementation share the same anchor,
+// a weak symbol resolved by the dynamic loader to a single definition, so that the
+// static constructors of different DSOs racing on their first measurement don't
+// parse procfs again. On Windows each module has its own anchor. A child created with
+// fork() empties the anchor, to measure from its own start.
+#define GTSPS_ANCHOR_EMPTY        0
+#define GTSPS_ANCHOR_INITIALIZING 1
+#define GTSPS_ANCHOR_READY        2
+#define GTSPS_ANCHOR_FAILED       3
+
+typedef struct gtsps_Anchor
+{
+    GTSPS_ATOMIC(int) state;
+    int               forkHandler;  //< The fork handler is registered, inherited by children
+    double            processStartTime;
+} gtsps_Anchor;
+
 GTSPS_NAMESPACE_END
-#undef GTSPS_NAMESPACE_BEGIN
-#undef GTSPS_NAMESPACE_END
-#undef GTSPS_LOG_ERROR
 
+#if defined(_WIN32)
+static GTSPS_QUALIFIED(gtsps_Anchor) gtsps_processAnchor;
+#else
+#   ifdef __cplusplus
+extern "C" {
+#   endif
+__attribute__((weak, visibility("default"))) GTSPS_QUALIFIED(gtsps_Anchor) gtsps_processAnchor;
+#   ifdef __cplusplus
+}
+#   endif
+#endif
+
+GTSPS_NAMESPACE_BEGIN
+
+#if !defined(_WIN32)
+static void gtsps_EmptyAnchorInChild()
+{
+    // The only thread of the child, a plain store is enough
+    GTSPS_ATOMIC_STORE(&gtsps_processAnchor.state, GTSPS_ANCHOR_EMPTY);
+}
+#endif
+
+// @brief  The process start time on the time scale of gtsps_ReadClock(), read once
+//         by the first caller. Concurrent callers wait for the first one to publish
+//         it, without locks.
+//
+// @return time in seconds, or 0.0 in case of error.
+static double gtsps_ProcessStartTime()
+{
+    gtsps_Anchor* anchor = &gtsps_processAnchor;
+    int state = GTSPS_ATOMIC_LOAD(&anchor->state);
+    if (state == GTSPS_ANCHOR_READY)
+        return anchor->processStartTime;
+
+    int expected = GTSPS_ANCHOR_EMPTY;
+    if (state == GTSPS_ANCHOR_EMPTY && GTSPS_ATOMIC_CAS(&anchor->state, &expected, GTSPS_ANCHOR_INITIALIZING))
+    {
+#if !defined(_WIN32)
+        // Once per process image, children inherit the registration
+        if (!anchor->forkHandler)
+            anchor->forkHandler = pthread_atfork(NULL, NULL, gtsps_EmptyAnchorInChild) == 0;
+#endif
+        double startTime = gtsps_ReadProcessStartTime();
+        anchor->processStartTime = startTime;
+        GTSPS_ATOMIC_STORE(&anchor->state, startTime != 0.0 ? GTSPS_ANCHOR_READY : GTSPS_ANCHOR_FAILED);
+        return startTime;
+    }
+
+    while ((state = GTSPS_ATOMIC_LOAD(&anchor->state)) == GTSPS_ANCHOR_INITIALIZING)
+    {
+#if defined(_WIN32)
+        SwitchToThread();
+#else
+        sched_yield();
+#endif
+    }
+    return state == GTSPS_ANCHOR_READY ? anchor->processStartTime : 0.0;
+}
+
+#undef GTSPS_ANCHOR_EMPTY
+#undef GTSPS_ANCHOR_INITIALIZING
+#undef GTSPS_ANCHOR_READY
+#undef GTSPS_ANCHOR_FAILED
+
+double GetTimeSinceProcessStart()
+{
+    double startTime = gtsps_ProcessStartTime();
+    if (startTime == 0.0)
+        return 0.0;
+
+    double timeInSeconds = gtsps_ReadClock() - startTime;
+    return timeInSeconds;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Startup timeline
+#ifndef GTSPS_DISABLE_INSTRUMENTATION
+
+// An event is published once written: readers only take the events before the
+// first one another thread is still writing
+static StartupEvent gtsps_events[GTSPS_TIMELINE_CAPACITY];
+static GTSPS_ATOMIC(unsigned char) gtsps_eventPublished[GTSPS_TIMELINE_CAPACITY];
+static GTSPS_ATOMIC(int) gtsps_eventCount;
+static GTSPS_THREAD_LOCAL int gtsps_openSpan = -1;
+
+static char gtsps_names[GTSPS_TIMELINE_NAMES_SIZE];
+static GTSPS_ATOMIC(int) gtsps_namesSize;
+
+// The progress counters tied to a span take their last sample when it ends
+static void gtsps_FinishProgress(int span);
+
+static double gtsps_TimelineNow()
+{
+    return GetTimeSinceProcessStart();
+}
+
+// @brief  Copies a name in the storage of the library, for names that don't live as
+//         long as the timeline, e.g. file paths.
+//
+// @return the copy, or the fallback name when the storage is exhausted.
+static const char* gtsps_CopyName(const char* name, const char* fallback)
+{
+    int size = (int)strlen(name) + 1;
+    int offset = GTSPS_ATOMIC_FETCH_ADD(&gtsps_namesSize, size);
+    if (offset + size > GTSPS_TIMELINE_NAMES_SIZE)
+        return fallback;
+
+    memcpy(gtsps_names + offset, name, (size_t)size);
+    return gtsps_names + offset;
+}
+
+static GTSPS_THREAD_LOCAL int gtsps_threadId;
+
+static int gtsps_CurrentThreadId()
+{
+    if (gtsps_threadId == 0)
+    {
+#if defined(_WIN32)
+        gtsps_threadId = (int)GetCurrentThreadId();
+#elif defined(linux) || defined(__linux__) || defined(__LINUX__)
+        gtsps_threadId = (int)syscall(SYS_gettid);
+#elif defined(__APPLE__) || defined(MACOSX) || defined(__MACOSX__)
+        uint64_t threadId = 0;
+        pthread_threadid_np(NULL, &threadId);
+        gtsps_threadId = (int)threadId;
+#endif
+    }
+    return gtsps_threadId;
+}
+
+static int gtsps_CurrentCpu()
+{
+#if defined(_WIN32)
+    return (int)GetCurrentProcessorNumber();
+#elif defined(linux) || defined(__linux__) || defined(__LINUX__)
+    unsigned cpu = 0;
+    return syscall(SYS_getcpu, &cpu, NULL, NULL) == 0 ? (int)cpu : -1;
+#else
+    return -1;
+#endif
+}
+
+#if defined(GTSPS_ENABLE_PERF_COUNTERS) && (defined(linux) || defined(__linux__) || defined(__LINUX__))
+///////////////////////////////////////////////////////////////////////////////
+// CPU counters
+
+// The counters form a single group, scheduled on the CPU together so that ratios like
+// the IPC are consistent. The group leader is read with PERF_FORMAT_GROUP. The CPU
+// time and the context switches come from getrusage() instead, of the thread like
+// the faults: a software counter excluding the kernel never sees a context switch,
+// and including it needs perf_event_paranoid <= 1.
+#define GTSPS_PERF_COUNTERS 3
+
+static int gtsps_perfLeader = -1;
+static int gtsps_perfSlots[GTSPS_PERF_COUNTERS];    //< Index in the group, -1 if not opened
+
+static int gtsps_OpenPerfCounter(uint32_t type, uint64_t config, int leader)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = type;
+    attr.config         = config;
+    attr.read_format    = PERF_FORMAT_GROUP;
+    attr.inherit        = 1;    //< Count the threads created from now on
+    attr.exclude_kernel = 1;    //< Allowed with perf_event_paranoid <= 2
+    attr.exclude_hv     = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader, PERF_FLAG_FD_CLOEXEC);
+}
+
+// Opened before the static init of the program,  the counters are inherited by all
+// the threads but the ones already running, e.g. threads started by preloaded DSOs.
+__attribute__((constructor(101))) static void gtsps_OpenPerfCounters()
+{
+    // Launches that are not sampled don't pay for the inherited counters
+    if (!StartupIsSampled())
+        return;
+
+    static const struct { uint32_t type; uint64_t config; } counters[GTSPS_PERF_COUNTERS] = {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    };
+
+    // Hardware counters are missing in most VMs and containers, or not permitted: a
+    // counter that fails to open is left out of the group
+    int slot = 0;
+    for (int i = 0; i < GTSPS_PERF_COUNTERS; ++i)
+    {
+        gtsps_perfSlots[i] = -1;
+        int fd = gtsps_OpenPerfCounter(counters[i].type, counters[i].config, gtsps_perfLeader);
+        if (fd < 0)
+            continue;
+        if (gtsps_perfLeader < 0)
+            gtsps_perfLeader = fd;
+        gtsps_perfSlots[i] = slot++;
+    }
+}
+
+// @brief  Adds the values of the counters of the process to the CPU counters.
+static void gtsps_ReadPerfCounters(StartupCounters* counters)
+{
+    uint64_t values[1 + GTSPS_PERF_COUNTERS];
+    if (gtsps_perfLeader < 0 || read(gtsps_perfLeader, values, sizeof(values)) < (ssize_t)sizeof(uint64_t))
+        return;
+
+    uint64_t* fields[GTSPS_PERF_COUNTERS] = { &counters->instructions, &counters->cycles, &counters->cacheMisses };
+    for (int i = 0; i < GTSPS_PERF_COUNTERS; ++i)
+    {
+        if (gtsps_perfSlots[i] >= 0 && (uint64_t)gtsps_perfSlots[i] < values[0])
+            *fields[i] = values[1 + gtsps_perfSlots[i]];
+    }
+}
+
+#undef GTSPS_PERF_COUNTERS
+#else
+static void gtsps_ReadPerfCounters(StartupCounters* counters) { (void)counters; }
+#endif
+
+// @brief  Reads the resource usage of the calling thread, or of the whole process.
+static void gtsps_ReadCounters(StartupCounters* counters, int wholeProcess)
+{
+    memset(counters, 0, sizeof(*counters));
+#if defined(_WIN32)
+    (void)wholeProcess;
+#else
+    struct rusage usage;
+#   if defined(RUSAGE_THREAD)
+    getrusage(wholeProcess ? RUSAGE_SELF : RUSAGE_THREAD, &usage);
+#   else
+    (void)wholeProcess;
+    getrusage(RUSAGE_SELF, &usage);
+#   endif
+    counters->minorFaults = (uint64_t)usage.ru_minflt;
+    counters->majorFaults = (uint64_t)usage.ru_majflt;
+    counters->readBlocks  = (uint64_t)usage.ru_inblock;
+    counters->writeBlocks = (uint64_t)usage.ru_oublock;
+    counters->taskClock   = ((uint64_t)usage.ru_utime.tv_sec + (uint64_t)usage.ru_stime.tv_sec) * 1000000000ull +
+                            ((uint64_t)usage.ru_utime.tv_usec + (uint64_t)usage.ru_stime.tv_usec) * 1000ull;
+    counters->contextSwitches = (uint64_t)(usage.ru_nvcsw + usage.ru_nivcsw);
+    gtsps_ReadPerfCounters(counters);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Live event stream
+#if defined(GTSPS_ENABLE_LIVE_RING) && !defined(_WIN32)
+
+#define GTSPS_LIVE_MAGIC   0x45564c5350535447ull  //< "GTSPSLVE"
+#define GTSPS_LIVE_VERSION 2
+
+// The file is a header followed by the rings. The head and the tail of a ring are on
+// separate cache lines, written by the producer and by the consumer respectively.
+typedef struct gtsps_LiveHeader
+{
+    GTSPS_ATOMIC(uint64_t) magic;   //< Written last
+    uint32_t               version;
+    uint32_t               ringCount;
+    uint32_t               ringCapacity;
+    int32_t                pid;
+    GTSPS_ATOMIC(int)      ringsUsed;
+    char                   padding[64 - 24 - sizeof(GTSPS_ATOMIC(int))];
+} gtsps_LiveHeader;
+
+typedef struct gtsps_LiveRing
+{
+    GTSPS_ATOMIC(uint64_t) head;
+    GTSPS_ATOMIC(uint64_t) dropped;
+    char                   headPadding[64 - 2 * sizeof(GTSPS_ATOMIC(uint64_t))];
+    GTSPS_ATOMIC(uint64_t) tail;
+    char                   tailPadding[64 - sizeof(GTSPS_ATOMIC(uint64_t))];
+} gtsps_LiveRing;   //< Followed by the events
+
+static gtsps_LiveHeader* gtsps_liveHeader;
+static GTSPS_THREAD_LOCAL gtsps_LiveRing* gtsps_liveRing;
+static GTSPS_THREAD_LOCAL int gtsps_liveRingClaimed;
+
+static size_t gtsps_LiveRingStride(uint32_t ringCapacity)
+{
+    return sizeof(gtsps_LiveRing) + (size_t)ringCapacity * sizeof(StartupLiveEvent);
+}
+
+static gtsps_LiveRing* gtsps_LiveRingAt(gtsps_LiveHeader* header, int index)
+{
+    return (gtsps_LiveRing*)((char*)(header + 1) + (size_t)index * gtsps_LiveRingStride(header->ringCapacity));
+}
+
+static void gtsps_StopLiveRingInChild()
+{
+    gtsps_liveHeader = NULL;
+}
+
+__attribute__((constructor(101))) static void gtsps_CreateLiveRing()
+{
+    const char* path = getenv("GTSPS_LIVE_RING");
+    if (!path || !path[0])
+        return;
+
+    // A new file, readers of a previous run keep the old one
+    size_t size = sizeof(gtsps_LiveHeader) + GTSPS_LIVE_RING_THREADS * gtsps_LiveRingStride(GTSPS_LIVE_RING_CAPACITY);
+    unlink(path);
+    int fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    void* mapping = MAP_FAILED;
+    if (fd >= 0 && ftruncate(fd, (off_t)size) == 0)
+        mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (fd >= 0)
+        close(fd);
+
+    // Programs this one runs would recreate the file and replace its ring
+    unsetenv("GTSPS_LIVE_RING");
+    if (mapping == MAP_FAILED)
+    {
+        GTSPS_LOG_ERROR("Error: Failed to create the live event ring.\n");
+        return;
+    }
+
+    gtsps_LiveHeader* header = (gtsps_LiveHeader*)mapping;
+    header->version = GTSPS_LIVE_VERSION;
+    header->ringCount = GTSPS_LIVE_RING_THREADS;
+    header->ringCapacity = GTSPS_LIVE_RING_CAPACITY;
+    header->pid = (int32_t)getpid();
+    GTSPS_ATOMIC_STORE(&header->ringsUsed, 0);
+    GTSPS_ATOMIC_STORE(&header->magic, GTSPS_LIVE_MAGIC);
+
+    pthread_atfork(NULL, NULL, gtsps_StopLiveRingInChild);
+    gtsps_liveHeader = header;
+}
+
+static void gtsps_LivePublish(int type, int span, const char* name, double time, int thread, uint64_t value,
+                              uint64_t total)
+{
+    gtsps_LiveHeader* header = gtsps_liveHeader;
+    if (!header)
+        return;
+
+    // Each thread claims a ring at its first event
+    if (!gtsps_liveRingClaimed)
+    {
+        gtsps_liveRingClaimed = 1;
+        int index = GTSPS_ATOMIC_FETCH_ADD(&header->ringsUsed, 1);
+        if (index < (int)header->ringCount)
+            gtsps_liveRing = gtsps_LiveRingAt(header, index);
+    }
+    gtsps_LiveRing* ring = gtsps_liveRing;
+    if (!ring)
+        return;
+
+    uint64_t head = GTSPS_ATOMIC_LOAD(&ring->head);
+    if (head - GTSPS_ATOMIC_LOAD(&ring->tail) >= GTSPS_LIVE_RING_CAPACITY)
+    {
+        GTSPS_ATOMIC_FETCH_ADD(&ring->dropped, 1);
+        return;
+    }
+
+    StartupLiveEvent* event = (StartupLiveEvent*)(ring + 1) + (head & (GTSPS_LIVE_RING_CAPACITY - 1));
+    event->time = time;
+    event->value = value;
+    event->total = total;
+    event->type = type;
+    event->span = span;
+    event->thread = thread;
+    size_t length = 0;
+    while (length < sizeof(event->name) - 1 && name[length])
+    {
+        event->name[length] = name[length];
+        ++length;
+    }
+    event->name[length] = '\0';
+    GTSPS_ATOMIC_STORE(&ring->head, head + 1);
+}
+
+int OpenStartupLiveRing(const char* path, StartupLiveReader* reader)
+{
+    memset(reader, 0, sizeof(*reader));
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+        return 0;
+
+    struct stat info;
+    void* mapping = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(gtsps_LiveHeader))
+        mapping = mmap(NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return 0;
+
+    // The file may be mapped before the process initialized it
+    gtsps_LiveHeader* header = (gtsps_LiveHeader*)mapping;
+    if (GTSPS_ATOMIC_LOAD(&header->magic) != GTSPS_LIVE_MAGIC ||
+        header->version != GTSPS_LIVE_VERSION || header->ringCapacity == 0 ||
+        (header->ringCapacity & (header->ringCapacity - 1)) != 0 ||
+        sizeof(gtsps_LiveHeader) + header->ringCount * gtsps_LiveRingStride(header->ringCapacity) > (size_t)info.st_size)
+    {
+        munmap(mapping, (size_t)info.st_size);
+        return 0;
+    }
+    reader->mapping = mapping;
+    reader->size = (size_t)info.st_size;
+    reader->pid = header->pid;
+    return 1;
+}
+
+int PollStartupLiveRing(StartupLiveReader* reader, StartupLiveEvent* events, int capacity)
+{
+    gtsps_LiveHeader* header = (gtsps_LiveHeader*)reader->mapping;
+    if (!header)
+        return 0;
+
+    int ringsUsed = GTSPS_ATOMIC_LOAD(&header->ringsUsed);
+    if (ringsUsed > (int)header->ringCount)
+        ringsUsed = (int)header->ringCount;
+
+    int count = 0;
+    uint64_t dropped = 0;
+    for (int i = 0; i < ringsUsed; ++i)
+    {
+        gtsps_LiveRing* ring = gtsps_LiveRingAt(header, i);
+        const StartupLiveEvent* ringEvents = (const StartupLiveEvent*)(ring + 1);
+        uint64_t head = GTSPS_ATOMIC_LOAD(&ring->head);
+        uint64_t tail = GTSPS_ATOMIC_LOAD(&ring->tail);
+        while (tail < head && count < capacity)
+            events[count++] = ringEvents[tail++ & (header->ringCapacity - 1)];
+        GTSPS_ATOMIC_STORE(&ring->tail, tail);
+        dropped += GTSPS_ATOMIC_LOAD(&ring->dropped);
+    }
+    reader->dropped = dropped;
+    return count;
+}
+
+void CloseStartupLiveRing(StartupLiveReader* reader)
+{
+    if (reader->mapping)
+        munmap(reader->mapping, reader->size);
+    memset(reader, 0, sizeof(*reader));
+}
+
+#undef GTSPS_LIVE_MAGIC
+#undef GTSPS_LIVE_VERSION
+#else
+static void gtsps_LivePublish(int type, int span, const char* name, double time, int thread, uint64_t value,
+                              uint64_t total)
+{
+    (void)type;
+    (void)span;
+    (void)name;
+    (void)time;
+    (void)thread;
+    (void)value;
+    (void)total;
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Sampling
+
+#define GTSPS_SAMPLING_UNDECIDED 0
+#define GTSPS_SAMPLING_DECIDING  1
+#define GTSPS_SAMPLING_OFF       2
+#define GTSPS_SAMPLING_ON        3
+
+static GTSPS_ATOMIC(int) gtsps_sampling;
+
+// @brief  Takes a token from the bucket shared by the processes of the user, refilled
+//         at budget tokens per minute. The file is created readable and writable by
+//         the user only, to share a budget between users create it beforehand with
+//         the permissions of their group.  The first event may be recorded from a
+//         static constructor, a bucket locked by another process doesn't block it.
+//
+// @return 1 if a token was available, 0 otherwise.
+static int gtsps_TakeSamplingToken(double budget)
+{
+#if defined(_WIN32)
+    (void)budget;
+    return 1;
+#else
+    const char* path = getenv("GTSPS_SAMPLE_BUDGET_FILE");
+    char defaultPath[64];
+    if (!path)
+    {
+        snprintf(defaultPath, sizeof(defaultPath), "/dev/shm/gtsps_sample_budget_%u", (unsigned)getuid());
+        path = defaultPath;
+    }
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC | O_NOFOLLOW, 0600);
+    if (fd < 0)
+    {
+        GTSPS_LOG_ERROR("Error: Failed to open the sampling budget file.\n");
+        return 0;
+    }
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0)
+    {
+        // Contended by another launch, or failed: not sampled either way
+        close(fd);
+        return 0;
+    }
+
+    // The bucket holds the time of the last refill and the tokens left
+    double now = gtsps_ReadClock();
+    double bucket[2];
+    if (pread(fd, bucket, sizeof(bucket), 0) != (ssize_t)sizeof(bucket) || bucket[0] > now)
+    {
+        bucket[0] = now;
+        bucket[1] = budget;
+    }
+    bucket[1] += (now - bucket[0]) * budget / 60.0;
+    if (bucket[1] > budget)
+        bucket[1] = budget;
+    bucket[0] = now;
+
+    int sampled = bucket[1] >= 1.0;
+    if (sampled)
+        bucket[1] -= 1.0;
+    if (pwrite(fd, bucket, sizeof(bucket), 0) != (ssize_t)sizeof(bucket))
+        sampled = 0;
+
+    flock(fd, LOCK_UN);
+    close(fd);
+    return sampled;
+#endif
+}
+
+static int gtsps_DecideSampling()
+{
+    const char* rate = getenv("GTSPS_SAMPLE_RATE");
+    if (rate)
+    {
+        // A random number per launch, seeded with the clock and the process id
+#if defined(_WIN32)
+        uint64_t seed = (uint64_t)GetCurrentProcessId();
+#else
+        uint64_t seed = (uint64_t)getpid();
+#endif
+        seed = seed * 0x9E3779B97F4A7C15ull ^ (uint64_t)(gtsps_ReadClock() * 1e9);
+        seed ^= seed >> 33;
+        seed *= 0xFF51AFD7ED558CCDull;
+        seed ^= seed >> 33;
+        if ((double)(seed >> 11) / 9007199254740992.0 >= atof(rate))
+            return 0;
+    }
+
+    const char* budget = getenv("GTSPS_SAMPLE_BUDGET");
+    if (budget)
+        return gtsps_TakeSamplingToken(atof(budget));
+    return 1;
+}
+
+int StartupIsSampled()
+{
+    int state = GTSPS_ATOMIC_LOAD(&gtsps_sampling);
+    if (state >= GTSPS_SAMPLING_OFF)
+        return state == GTSPS_SAMPLING_ON;
+
+    int expected = GTSPS_SAMPLING_UNDECIDED;
+    if (state == GTSPS_SAMPLING_UNDECIDED &&
+        GTSPS_ATOMIC_CAS(&gtsps_sampling, &expected, GTSPS_SAMPLING_DECIDING))
+    {
+        int sampled = gtsps_DecideSampling();
+        GTSPS_ATOMIC_STORE(&gtsps_sampling, sampled ? GTSPS_SAMPLING_ON : GTSPS_SAMPLING_OFF);
+        return sampled;
+    }
+
+    while ((state = GTSPS_ATOMIC_LOAD(&gtsps_sampling)) == GTSPS_SAMPLING_DECIDING)
+    {
+#if defined(_WIN32)
+        SwitchToThread();
+#else
+        sched_yield();
 #endif
+    }
+    return state == GTSPS_SAMPLING_ON;
+}
+
+#undef GTSPS_SAMPLING_UNDECIDED
+#undef GTSPS_SAMPLING_DECIDING
+#undef GTSPS_SAMPLING_OFF
+#undef GTSPS_SAMPLING_ON
+
+// @brief  Adds an event to the timeline, beginning at the given time on the timeline,
+//         or now when negative.
+//
+// @return the index of the event, -1 if it isn't recorded.
+static int gtsps_AddEventAt(const char* name, int type, double begin)
+{
+    // Launches that are not sampled only record marks
+    int sampled = StartupIsSampled();
+    if (!sampled && type != GTSPS_EVENT_MARK)
+        return -1;
+
+    int index = GTSPS_ATOMIC_FETCH_ADD(&gtsps_eventCount, 1);
+    if (index >= GTSPS_TIMELINE_CAPACITY)
+        return -1;
+
+    StartupEvent* event = &gtsps_events[index];
+    event->name   = name;
+    event->type   = type;
+    event->parent = gtsps_openSpan;
+    event->thread = gtsps_CurrentThreadId();
+    event->cpu    = gtsps_CurrentCpu();
+    if (sampled)
+        gtsps_ReadCounters(&event->counters, type == GTSPS_EVENT_MARK);
+    else
+        memset(&event->counters, 0, sizeof(event->counters));
+    event->begin  = begin >= 0.0 ? begin : gtsps_TimelineNow();
+    event->end    = type == GTSPS_EVENT_MARK ? event->begin : -1.0;
+    GTSPS_ATOMIC_STORE(&gtsps_eventPublished[index], 1);
+    gtsps_LivePublish(type == GTSPS_EVENT_MARK ? GTSPS_LIVE_MARK : GTSPS_LIVE_BEGIN, index, name, event->begin,
+                      event->thread, 0, 0);
+    return index;
+}
+
+// @brief  Counts the events readers can take, up to the first one not published yet.
+static int gtsps_PublishedEventCount()
+{
+    int count = GTSPS_ATOMIC_LOAD(&gtsps_eventCount);
+    if (count > GTSPS_TIMELINE_CAPACITY)
+        count = GTSPS_TIMELINE_CAPACITY;
+    for (int i = 0; i < count; ++i)
+    {
+        if (!GTSPS_ATOMIC_LOAD(&gtsps_eventPublished[i]))
+            return i;
+    }
+    return count;
+}
+
+static int gtsps_AddEvent(const char* name, int type)
+{
+    return gtsps_AddEventAt(name, type, -1.0);
+}
+
+void StartupMark(const char* name)
+{
+    gtsps_AddEvent(name, GTSPS_EVENT_MARK);
+}
+
+int StartupSpanBegin(const char* name)
+{
+    int span = gtsps_AddEvent(name, GTSPS_EVENT_SPAN);
+    if (span >= 0)
+        gtsps_openSpan = span;
+    return span;
+}
+
+int StartupSpanBeginAt(const void* code)
+{
+    if (!StartupIsSampled())
+        return -1;
+
+    char name[2 + 2 * sizeof(void*) + 1];
+    snprintf(name, sizeof(name), "0x%llx", (unsigned long long)(uintptr_t)code);
+    return StartupSpanBegin(gtsps_CopyName(name, "code"));
+}
+
+void StartupSpanEnd(int span)
+{
+    if (span < 0 || span >= GTSPS_TIMELINE_CAPACITY)
+        return;
+
+    StartupEvent* event = &gtsps_events[span];
+    event->end = gtsps_TimelineNow();
+
+    StartupCounters counters;
+    gtsps_ReadCounters(&counters, 0);
+    event->counters.minorFaults     = counters.minorFaults     - event->counters.minorFaults;
+    event->counters.majorFaults     = counters.majorFaults     - event->counters.majorFaults;
+    event->counters.readBlocks      = counters.readBlocks      - event->counters.readBlocks;
+    event->counters.writeBlocks     = counters.writeBlocks     - event->counters.writeBlocks;
+    event->counters.instructions    = counters.instructions    - event->counters.instructions;
+    event->counters.cycles          = counters.cycles          - event->counters.cycles;
+    event->counters.cacheMisses     = counters.cacheMisses     - event->counters.cacheMisses;
+    event->counters.taskClock       = counters.taskClock       - event->counters.taskClock;
+    event->counters.contextSwitches = counters.contextSwitches - event->counters.contextSwitches;
+    gtsps_openSpan = event->parent;
+    gtsps_LivePublish(GTSPS_LIVE_END, span, event->name, event->end, event->thread, 0, 0);
+    gtsps_FinishProgress(span);
+}
+
+int GetStartupTimeline(StartupEvent* events, int capacity)
+{
+    int count = gtsps_PublishedEventCount();
+    if (count > capacity)
+        count = capacity;
+
+    memcpy(events, gtsps_events, sizeof(StartupEvent) * (size_t)count);
+    return count;
+}
+
+void PrintStartupTimeline(FILE* out)
+{
+    int count = GTSPS_ATOMIC_LOAD(&gtsps_eventCount);
+    if (count > GTSPS_TIMELINE_CAPACITY)
+        fprintf(out, "Startup timeline: %d events dropped, increase GTSPS_TIMELINE_CAPACITY\n",
+                count - GTSPS_TIMELINE_CAPACITY);
+    count = gtsps_PublishedEventCount();
+
+    fprintf(out, "%10s %10s %10s %5s  %s\n", "begin", "end", "duration", "ipc", "name");
+    for (int i = 0; i < count; ++i)
+    {
+        const StartupEvent* event = &gtsps_events[i];
+
+        int depth = 0;
+        for (int parent = event->parent; parent >= 0; parent = gtsps_events[parent].parent)
+            ++depth;
+
+        // Instructions per cycle: a low IPC points at a phase stalled on memory
+        char ipc[16] = "";
+        if (event->counters.cycles > 0)
+            snprintf(ipc, sizeof(ipc), "%.2f", (double)event->counters.instructions / (double)event->counters.cycles);
+
+        if (event->type == GTSPS_EVENT_MARK)
+            fprintf(out, "%10.6f %10s %10s %5s  %*s%s\n", event->begin, "", "", ipc, depth * 2, "", event->name);
+        else if (event->end < 0.0)
+            fprintf(out, "%10.6f %10s %10s %5s  %*s%s\n", event->begin, "open", "", "", depth * 2, "", event->name);
+        else
+            fprintf(out, "%10.6f %10.6f %10.6f %5s  %*s%s\n", event->begin, event->end,
+                    event->end - event->begin, ipc, depth * 2, "", event->name);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Progress counters
+
+typedef struct gtsps_ProgressSample
+{
+    double   time;
+    uint64_t value;
+} gtsps_ProgressSample;
+
+// The samples are written by the sampler thread,  and once more by the thread that
+// finishes the counter. Writers make the generation odd while they write, readers copy
+// the samples and retry if the generation changed meanwhile. The generation is 0 until
+// the counter is created.
+typedef struct gtsps_Progress
+{
+    const char*            name;
+    uint64_t               total;
+    int                    phase;       //< Index of the span the counter is tied to, or -1
+    int                    stride;      //< Sampled once every stride periods
+    int                    sampleCount;
+    GTSPS_ATOMIC(uint64_t) value;
+    GTSPS_ATOMIC(unsigned) generation;
+    GTSPS_ATOMIC(int)      finished;    //< 1 once the last sample is taken
+    gtsps_ProgressSample   samples[GTSPS_PROGRESS_SAMPLES];
+} gtsps_Progress;
+
+// The sampler thread is idle, running, or running and asked to look for new counters
+// before it exits
+#define GTSPS_SAMPLER_IDLE    0
+#define GTSPS_SAMPLER_RUNNING 1
+#define GTSPS_SAMPLER_RESCAN  2
+
+// A reader gives up on samples that keep changing after these many copies
+#define GTSPS_PROGRESS_COPY_ATTEMPTS 64
+
+static gtsps_Progress gtsps_progress[GTSPS_MAX_PROGRESS_COUNTERS];
+static GTSPS_ATOMIC(int) gtsps_progressCount;
+static GTSPS_ATOMIC(int) gtsps_progressStopped;
+static GTSPS_ATOMIC(int) gtsps_progressSampler;
+
+static void gtsps_SampleProgress(gtsps_Progress* progress, int thread)
+{
+    unsigned generation = GTSPS_ATOMIC_LOAD(&progress->generation);
+    while ((generation & 1) || !GTSPS_ATOMIC_CAS(&progress->generation, &generation, generation + 1))
+    {
+#if defined(_WIN32)
+        SwitchToThread();
+#else
+        sched_yield();
+#endif
+        generation = GTSPS_ATOMIC_LOAD(&progress->generation);
+    }
+
+    // Out of samples, keep one in two and halve the sampling rate
+    if (progress->sampleCount == GTSPS_PROGRESS_SAMPLES)
+    {
+        for (int i = 1; i < GTSPS_PROGRESS_SAMPLES / 2; ++i)
+            progress->samples[i] = progress->samples[2 * i];
+        progress->sampleCount = GTSPS_PROGRESS_SAMPLES / 2;
+        progress->stride *= 2;
+    }
+    gtsps_ProgressSample* sample = &progress->samples[progress->sampleCount++];
+    sample->time = gtsps_TimelineNow();
+    sample->value = GTSPS_ATOMIC_LOAD(&progress->value);
+
+    GTSPS_ATOMIC_STORE(&progress->generation, generation + 2);
+    gtsps_LivePublish(GTSPS_LIVE_PROGRESS, progress->phase, progress->name, sample->time, thread, sample->value,
+                      progress->total);
+}
+
+// @brief  Takes the last sample of a counter, once.
+static void gtsps_FinishCounter(gtsps_Progress* progress, int thread)
+{
+    int expected = 0;
+    if (GTSPS_ATOMIC_LOAD(&progress->generation) != 0 && GTSPS_ATOMIC_CAS(&progress->finished, &expected, 1))
+        gtsps_SampleProgress(progress, thread);
+}
+
+static void gtsps_StopProgressSampling()
+{
+    int expected = 0;
+    if (!GTSPS_ATOMIC_CAS(&gtsps_progressStopped, &expected, 1))
+        return;
+
+    int count = GTSPS_ATOMIC_LOAD(&gtsps_progressCount);
+    if (count > GTSPS_MAX_PROGRESS_COUNTERS)
+        count = GTSPS_MAX_PROGRESS_COUNTERS;
+    int thread = gtsps_CurrentThreadId();
+    for (int i = 0; i < count; ++i)
+        gtsps_FinishCounter(&gtsps_progress[i], thread);
+}
+
+static void gtsps_FinishProgress(int span)
+{
+    int count = GTSPS_ATOMIC_LOAD(&gtsps_progressCount);
+    if (count > GTSPS_MAX_PROGRESS_COUNTERS)
+        count = GTSPS_MAX_PROGRESS_COUNTERS;
+    int thread = -1;
+    for (int i = 0; i < count; ++i)
+    {
+        if (gtsps_progress[i].phase != span || GTSPS_ATOMIC_LOAD(&gtsps_progress[i].generation) == 0)
+            continue;
+        if (thread < 0)
+            thread = gtsps_CurrentThreadId();
+        gtsps_FinishCounter(&gtsps_progress[i], thread);
+    }
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI gtsps_ProgressSampler(LPVOID arg)
+#else
+static void* gtsps_ProgressSampler(void* arg)
+#endif
+{
+    (void)arg;
+    int thread = gtsps_CurrentThreadId();
+    for (long tick = 1;; ++tick)
+    {
+#if defined(_WIN32)
+        Sleep(GTSPS_PROGRESS_PERIOD_MS);
+#else
+        usleep(GTSPS_PROGRESS_PERIOD_MS * 1000);
+#endif
+        // Past the time limit the counters take their last sample, as in StartupReady()
+        if (gtsps_TimelineNow() * 1000.0 >= (double)GTSPS_PROGRESS_MAX_MS)
+            gtsps_StopProgressSampling();
+
+        int live = 0;
+        int count = GTSPS_ATOMIC_LOAD(&gtsps_progressCount);
+        for (int i = 0; i < count && i < GTSPS_MAX_PROGRESS_COUNTERS; ++i)
+        {
+            gtsps_Progress* progress = &gtsps_progress[i];
+            if (GTSPS_ATOMIC_LOAD(&progress->generation) == 0 || GTSPS_ATOMIC_LOAD(&progress->finished))
+                continue;
+            ++live;
+            if (tick % progress->stride == 0)
+                gtsps_SampleProgress(progress, thread);
+        }
+
+        // Nothing left to sample, unless a counter was created since the scan
+        int state = GTSPS_SAMPLER_RUNNING;
+        if (live == 0 && GTSPS_ATOMIC_CAS(&gtsps_progressSampler, &state, GTSPS_SAMPLER_IDLE))
+            break;
+        if (state == GTSPS_SAMPLER_RESCAN)
+            GTSPS_ATOMIC_STORE(&gtsps_progressSampler, GTSPS_SAMPLER_RUNNING);
+    }
+    return 0;
+}
+
+// @brief  Starts the sampler thread, or has the running one sample a new counter.
+static void gtsps_StartProgressSampler()
+{
+    int state = GTSPS_ATOMIC_LOAD(&gtsps_progressSampler);
+    for (;;)
+    {
+        if (state == GTSPS_SAMPLER_RESCAN ||
+            (state == GTSPS_SAMPLER_RUNNING &&
+             GTSPS_ATOMIC_CAS(&gtsps_progressSampler, &state, GTSPS_SAMPLER_RESCAN)))
+            return;
+        if (state == GTSPS_SAMPLER_IDLE && GTSPS_ATOMIC_CAS(&gtsps_progressSampler, &state, GTSPS_SAMPLER_RUNNING))
+            break;
+    }
+
+#if defined(_WIN32)
+    HANDLE thread = CreateThread(NULL, 0, gtsps_ProgressSampler, NULL, 0, NULL);
+    if (thread)
+        CloseHandle(thread);
+    else
+#else
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, gtsps_ProgressSampler, NULL) == 0)
+        pthread_detach(thread);
+    else
+#endif
+    {
+        GTSPS_ATOMIC_STORE(&gtsps_progressSampler, GTSPS_SAMPLER_IDLE);
+        GTSPS_LOG_ERROR("Error: Failed to start the progress sampler.\n");
+    }
+}
+
+int StartupProgressCreate(const char* name, uint64_t total)
+{
+    // Launches that are not sampled don't run the sampler thread
+    if (!StartupIsSampled())
+        return -1;
+
+    int index = GTSPS_ATOMIC_FETCH_ADD(&gtsps_progressCount, 1);
+    if (index >= GTSPS_MAX_PROGRESS_COUNTERS)
+    {
+        GTSPS_LOG_ERROR("Error: Too many progress counters, increase GTSPS_MAX_PROGRESS_COUNTERS.\n");
+        return -1;
+    }
+
+    gtsps_Progress* progress = &gtsps_progress[index];
+    progress->name = name;
+    progress->total = total;
+    progress->phase = gtsps_openSpan;
+    progress->stride = 1;
+    progress->sampleCount = 1;
+    progress->samples[0].time = gtsps_TimelineNow();
+    progress->samples[0].value = 0;
+    GTSPS_ATOMIC_STORE(&progress->generation, 2);
+
+    // Counters created after StartupReady() keep their first sample only
+    if (GTSPS_ATOMIC_LOAD(&gtsps_progressStopped))
+        gtsps_FinishCounter(progress, gtsps_CurrentThreadId());
+    else
+        gtsps_StartProgressSampler();
+    return index;
+}
+
+void StartupProgressAdd(int counter, uint64_t amount)
+{
+    if (counter < 0 || counter >= GTSPS_MAX_PROGRESS_COUNTERS)
+        return;
+    GTSPS_ATOMIC_FETCH_ADD(&gtsps_progress[counter].value, amount);
+}
+
+#undef GTSPS_SAMPLER_IDLE
+#undef GTSPS_SAMPLER_RUNNING
+#undef GTSPS_SAMPLER_RESCAN
+
+// @brief  Copies the samples of a counter, consistent with the sampler thread. The
+//         reader yields between attempts, and gives up after
+//         GTSPS_PROGRESS_COPY_ATTEMPTS of them.
+//
+// @return the number of samples, 0 if the counter isn't created yet or the samples
+//         kept changing.
+static int gtsps_CopyProgressSamples(gtsps_Progress* progress, gtsps_ProgressSample* samples)
+{
+    for (int attempt = 0; attempt < GTSPS_PROGRESS_COPY_ATTEMPTS; ++attempt)
+    {
+        if (attempt > 0)
+        {
+#if defined(_WIN32)
+            SwitchToThread();
+#else
+            sched_yield();
+#endif
+        }
+
+        unsigned generation = GTSPS_ATOMIC_LOAD(&progress->generation);
+        if (generation == 0)
+            return 0;
+        if (generation & 1)
+            continue;
+
+        int count = progress->sampleCount;
+        memcpy(samples, progress->samples, (size_t)count * sizeof(gtsps_ProgressSample));
+        if (GTSPS_ATOMIC_LOAD(&progress->generation) == generation)
+            return count;
+    }
+    GTSPS_LOG_ERROR("Error: The samples of a progress counter kept changing, skipped.\n");
+    return 0;
+}
+
+#undef GTSPS_PROGRESS_COPY_ATTEMPTS
+
+static double gtsps_Rate(const gtsps_ProgressSample* from, const gtsps_ProgressSample* to)
+{
+    return to->time > from->time ? (double)(to->value - from->value) / (to->time - from->time) : 0.0;
+}
+
+void PrintStartupProgress(FILE* out)
+{
+    int count = GTSPS_ATOMIC_LOAD(&gtsps_progressCount);
+    if (count > GTSPS_MAX_PROGRESS_COUNTERS)
+        count = GTSPS_MAX_PROGRESS_COUNTERS;
+
+    gtsps_ProgressSample* samples = (gtsps_ProgressSample*)malloc(GTSPS_PROGRESS_SAMPLES * sizeof(gtsps_ProgressSample));
+    if (!samples)
+    {
+        GTSPS_LOG_ERROR("Error: Failed to allocate the progress report.\n");
+        return;
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        gtsps_Progress* progress = &gtsps_progress[i];
+        int sampleCount = gtsps_CopyProgressSamples(progress, samples);
+        if (sampleCount == 0)
+            continue;
+
+        // The current value, as an extra sample. This and the last sample of a
+        // finished counter end a partial period
+        int partial = GTSPS_ATOMIC_LOAD(&progress->finished);
+        if (sampleCount < GTSPS_PROGRESS_SAMPLES && !partial)
+        {
+            samples[sampleCount].time = gtsps_TimelineNow();
+            samples[sampleCount].value = GTSPS_ATOMIC_LOAD(&progress->value);
+            ++sampleCount;
+            partial = 1;
+        }
+        const gtsps_ProgressSample* first = &samples[0];
+        const gtsps_ProgressSample* last = &samples[sampleCount - 1];
+
+        fprintf(out, "Progress \"%s\"", progress->name);
+        if (progress->phase >= 0)
+            fprintf(out, " in \"%s\"", gtsps_events[progress->phase].name);
+        fprintf(out, ": %llu", (unsigned long long)last->value);
+        if (progress->total)
+            fprintf(out, " of %llu (%.1f%%)", (unsigned long long)progress->total,
+                    100.0 * (double)last->value / (double)progress->total);
+        fprintf(out, " at %.6f\n", last->time);
+
+        // Recent throughput over the last tenth of the time, at least a period, up to
+        // the last full period: a partial period is too short to tell the rate
+        int recentEnd = partial && sampleCount > 2 ? sampleCount - 2 : sampleCount - 1;
+        int recentBegin = recentEnd > 0 ? recentEnd - 1 : 0;
+        double window = (samples[recentEnd].time - first->time) * 0.1;
+        while (recentBegin > 0 && samples[recentBegin - 1].time >= samples[recentEnd].time - window)
+            --recentBegin;
+        double peakRate = 0.0, peakTime = 0.0;
+        for (int j = 1; j < sampleCount; ++j)
+        {
+            double rate = gtsps_Rate(&samples[j - 1], &samples[j]);
+            if (rate > peakRate)
+            {
+                peakRate = rate;
+                peakTime = samples[j].time;
+            }
+        }
+        double recentRate = gtsps_Rate(&samples[recentBegin], &samples[recentEnd]);
+        fprintf(out, "  throughput: average %.1f/s, recent %.1f/s, peak %.1f/s at %.6f\n", gtsps_Rate(first, last),
+                recentRate, peakRate, peakTime);
+        if (progress->total > last->value && recentRate > 0.0)
+            fprintf(out, "  expected end at %.6f, in %.3f seconds\n",
+                    last->time + (double)(progress->total - last->value) / recentRate,
+                    (double)(progress->total - last->value) / recentRate);
+
+        // Up to 20 rows of the throughput curve
+        fprintf(out, "  %10s %20s %14s\n", "time", "value", "throughput");
+        int step = (sampleCount - 1 + 19) / 20;
+        for (int j = 0; j < sampleCount - 1; j += step)
+        {
+            int next = j + step < sampleCount ? j + step : sampleCount - 1;
+            fprintf(out, "  %10.6f %20llu %12.1f/s\n", samples[next].time, (unsigned long long)samples[next].value,
+                    gtsps_Rate(&samples[j], &samples[next]));
+        }
+    }
+    free(samples);
+}
+
+void StartupReady()
+{
+    int ready = gtsps_AddEvent("ready", GTSPS_EVENT_MARK);
+    double readyTime = ready >= 0 ? gtsps_events[ready].begin : gtsps_TimelineNow();
+    gtsps_StopProgressSampling();
+
+    const char* progressReport = getenv("GTSPS_PROGRESS_REPORT");
+    if (progressReport && strcmp(progressReport, "0") != 0)
+        PrintStartupProgress(stderr);
+
+    const char* numaReport = getenv("GTSPS_NUMA_REPORT");
+    if (numaReport && strcmp(numaReport, "0") != 0)
+        PrintStartupNumaReport(stderr);
+
+#if defined(GTSPS_ENABLE_INIT_MEMORY)
+    StartupReleaseInitMemory();
+#endif
+
+#if !defined(_WIN32)
+    // A harness waits for the time to ready, see StartupTuneThreads()
+    const char* readyFd = getenv("GTSPS_READY_FD");
+    if (readyFd)
+    {
+        int fd = atoi(readyFd);
+        unsetenv("GTSPS_READY_FD");
+        if (fd > 2)
+        {
+            if (write(fd, &readyTime, sizeof(readyTime)) != (ssize_t)sizeof(readyTime))
+                GTSPS_LOG_ERROR("Error: Failed to report the time to ready.\n");
+            close(fd);
+        }
+    }
+#else
+    (void)readyTime;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Binary records
+
+#define GTSPS_RECORDS_MAGIC "GTSPSBIN"
+
+typedef struct gtsps_Buffer
+{
+    char*  data;
+    size_t size;
+    size_t capacity;
+    int    failed;
+} gtsps_Buffer;
+
+static void gtsps_AppendRecord(gtsps_Buffer* buffer, int type, const char* name, const void* payload,
+                               size_t payloadSize)
+{
+    size_t nameLength = strlen(name);
+    if (nameLength > 0xffff)
+        nameLength = 0xffff;
+
+    size_t size = (sizeof(StartupRecordHeader) + payloadSize + nameLength + 1 + 7) & ~(size_t)7;
+    if (buffer->size + size > buffer->capacity)
+    {
+        size_t capacity = (buffer->capacity ? buffer->capacity * 2 : 65536) + size;
+        char* data = (char*)realloc(buffer->data, capacity);
+        if (!data)
+        {
+            buffer->failed = 1;
+            return;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+
+    char* record = buffer->data + buffer->size;
+    memset(record, 0, size);
+
+    StartupRecordHeader header;
+    header.type = (uint16_t)type;
+    header.nameLength = (uint16_t)nameLength;
+    header.size = (uint32_t)size;
+    memcpy(record, &header, sizeof(header));
+    memcpy(record + sizeof(header), payload, payloadSize);
+    memcpy(record + sizeof(header) + payloadSize, name, nameLength);
+    buffer->size += size;
+}
+
+#if defined(linux) || defined(__linux__) || defined(__LINUX__)
+// @brief  Finds the GNU build-id among the notes in [note, end).
+//
+// @return the size of the build-id copied, 0 if there is none.
+static uint32_t gtsps_FindBuildIdNote(const char* note, const char* end, uint8_t* buildId, uint32_t capacity)
+{
+    while (end - note >= (ptrdiff_t)sizeof(ElfW(Nhdr)))
+    {
+        ElfW(Nhdr) header;
+        memcpy(&header, note, sizeof(header));
+        const char* name = note + sizeof(header);
+        const char* desc = name + ((header.n_namesz + 3) & ~3u);
+        const char* next = desc + ((header.n_descsz + 3) & ~3u);
+        if (next > end || next <= note)
+            break;
+
+        if (header.n_type == NT_GNU_BUILD_ID && header.n_namesz == 4 && memcmp(name, "GNU", 4) == 0)
+        {
+            uint32_t size = header.n_descsz < capacity ? (uint32_t)header.n_descsz : capacity;
+            memcpy(buildId, desc, size);
+            return size;
+        }
+        note = next;
+    }
+    return 0;
+}
+
+// @brief  Reads the build-id of a loaded module from the notes mapped in memory.
+//
+// @return the size of the build-id, 0 if the module has none.
+static uint32_t gtsps_ModuleBuildId(const gtsps_ModuleInfo* info, uint8_t* buildId, uint32_t capacity)
+{
+    for (int i = 0; i < info->dlpi_phnum; ++i)
+    {
+        const ElfW(Phdr)* segment = &info->dlpi_phdr[i];
+        if (segment->p_type != PT_NOTE)
+            continue;
+
+        const char* note = (const char*)(info->dlpi_addr + segment->p_vaddr);
+        uint32_t size = gtsps_FindBuildIdNote(note, note + segment->p_memsz, buildId, capacity);
+        if (size > 0)
+            return size;
+    }
+    return 0;
+}
+
+static int gtsps_AppendModuleRecord(gtsps_ModuleInfo* info, size_t infoSize, void* userData)
+{
+    (void)infoSize;
+    gtsps_Buffer* buffer = (gtsps_Buffer*)userData;
+
+    StartupModuleRecord module;
+    memset(&module, 0, sizeof(module));
+    module.loadBase = (uint64_t)info->dlpi_addr;
+    module.buildIdSize = gtsps_ModuleBuildId(info, module.buildId, sizeof(module.buildId));
+
+    const char* name = info->dlpi_name;
+    char executable[4096];
+    if (!name || !name[0])
+    {
+        // The main program has no name, resolve it
+        ssize_t length = readlink("/proc/self/exe", executable, sizeof(executable) - 1);
+        executable[length > 0 ? length : 0] = '\0';
+        name = executable;
+    }
+    gtsps_AppendRecord(buffer, GTSPS_RECORD_MODULE, name, &module, sizeof(module));
+    return 0;
+}
+#endif
+
+int AppendStartupRecords(const char* path)
+{
+    gtsps_Buffer buffer;
+    memset(&buffer, 0, sizeof(buffer));
+
+    int count = gtsps_PublishedEventCount();
+
+    StartupProcessRecord process;
+    memset(&process, 0, sizeof(process));
+#if defined(_WIN32)
+    process.pid = (int32_t)GetCurrentProcessId();
+#else
+    process.pid = (int32_t)getpid();
+#endif
+    process.eventCount = count;
+    process.writeTime = gtsps_TimelineNow();
+    gtsps_AppendRecord(&buffer, GTSPS_RECORD_PROCESS, "", &process, sizeof(process));
+
+#if defined(linux) || defined(__linux__) || defined(__LINUX__)
+    dl_iterate_phdr(gtsps_AppendModuleRecord, &buffer);
+#endif
+
+    for (int i = 0; i < count; ++i)
+    {
+        const StartupEvent* event = &gtsps_events[i];
+        StartupEventRecord record;
+        memset(&record, 0, sizeof(record));
+        record.begin = event->begin;
+        record.end = event->end;
+        record.parent = event->parent;
+        record.thread = event->thread;
+        record.cpu = event->cpu;
+        record.counters = event->counters;
+        gtsps_AppendRecord(&buffer, event->type == GTSPS_EVENT_MARK ? GTSPS_RECORD_MARK : GTSPS_RECORD_SPAN,
+                           event->name, &record, sizeof(record));
+    }
+
+    gtsps_ProgressSample* samples = (gtsps_ProgressSample*)malloc(GTSPS_PROGRESS_SAMPLES * sizeof(gtsps_ProgressSample));
+    int progressCount = GTSPS_ATOMIC_LOAD(&gtsps_progressCount);
+    for (int i = 0; i < progressCount && i < GTSPS_MAX_PROGRESS_COUNTERS && samples; ++i)
+    {
+        int sampleCount = gtsps_CopyProgressSamples(&gtsps_progress[i], samples);
+        for (int j = 0; j < sampleCount; ++j)
+        {
+            StartupCounterRecord record;
+            memset(&record, 0, sizeof(record));
+            record.time = samples[j].time;
+            record.value = samples[j].value;
+            record.total = gtsps_progress[i].total;
+            gtsps_AppendRecord(&buffer, GTSPS_RECORD_COUNTER, gtsps_progress[i].name, &record, sizeof(record));
+        }
+    }
+    if (!samples)
+        buffer.failed = 1;
+    free(samples);
+
+    if (buffer.failed)
+    {
+        GTSPS_LOG_ERROR("Error: Failed to allocate the records.\n");
+        free(buffer.data);
+        return 0;
+    }
+
+    char fileHeader[16];
+    memcpy(fileHeader, GTSPS_RECORDS_MAGIC, 8);
+    uint32_t version = GTSPS_RECORDS_VERSION, reserved = 0;
+    memcpy(fileHeader + 8, &version, 4);
+    memcpy(fileHeader + 12, &reserved, 4);
+
+    // The first process writing the file adds the file header. The writers hold an
+    // exclusive lock, so that two processes finding the file empty don't both write it.
+    // Readers don't lock, they stop at a record still being written.
+    int written = 0;
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file != INVALID_HANDLE_VALUE)
+    {
+        OVERLAPPED wholeFile;
+        memset(&wholeFile, 0, sizeof(wholeFile));
+        if (LockFileEx(file, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &wholeFile))
+        {
+            LARGE_INTEGER fileSize, end;
+            DWORD bytesWritten = 0, headerWritten = 0;
+            end.QuadPart = 0;
+            written = GetFileSizeEx(file, &fileSize) && SetFilePointerEx(file, end, NULL, FILE_END) &&
+                      (fileSize.QuadPart > 0 ||
+                       (WriteFile(file, fileHeader, sizeof(fileHeader), &headerWritten, NULL) &&
+                        headerWritten == sizeof(fileHeader))) &&
+                      WriteFile(file, buffer.data, (DWORD)buffer.size, &bytesWritten, NULL) &&
+                      bytesWritten == (DWORD)buffer.size;
+            UnlockFileEx(file, 0, MAXDWORD, MAXDWORD, &wholeFile);
+        }
+        written &= CloseHandle(file) != 0;
+    }
+#else
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd >= 0)
+    {
+        struct stat info;
+        if (flock(fd, LOCK_EX) == 0)
+        {
+            written = fstat(fd, &info) == 0 &&
+                      (info.st_size > 0 || write(fd, fileHeader, sizeof(fileHeader)) == (ssize_t)sizeof(fileHeader)) &&
+                      write(fd, buffer.data, buffer.size) == (ssize_t)buffer.size;
+            flock(fd, LOCK_UN);
+        }
+        written &= close(fd) == 0;
+    }
+#endif
+    free(buffer.data);
+
+    if (!written)
+        GTSPS_LOG_ERROR("Error: Failed to append the records.\n");
+    return written;
+}
+
+int OpenStartupRecords(const char* path, StartupRecordReader* reader)
+{
+    memset(reader, 0, sizeof(*reader));
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    LARGE_INTEGER fileSize;
+    fileSize.QuadPart = 0;
+    if (file != INVALID_HANDLE_VALUE && GetFileSizeEx(file, &fileSize) && fileSize.QuadPart >= 16)
+    {
+        // The view keeps the mapping alive once the handles are closed
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping)
+        {
+            reader->data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+    }
+    if (file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+    reader->size = (size_t)fileSize.QuadPart;
+#else
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat info;
+    if (fd >= 0 && fstat(fd, &info) == 0 && info.st_size >= 16)
+    {
+        void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            reader->data = (const char*)data;
+            reader->size = (size_t)info.st_size;
+        }
+    }
+    if (fd >= 0)
+        close(fd);
+#endif
+
+    if (!reader->data)
+    {
+        GTSPS_LOG_ERROR("Error: Failed to map the records file.\n");
+        return 0;
+    }
+
+    uint32_t version = 0;
+    memcpy(&version, reader->data + 8, 4);
+    if (memcmp(reader->data, GTSPS_RECORDS_MAGIC, 8) != 0 || version != GTSPS_RECORDS_VERSION)
+    {
+        GTSPS_LOG_ERROR("Error: Not a records file, or unsupported version.\n");
+        CloseStartupRecords(reader);
+        return 0;
+    }
+    reader->offset = 16;
+    return 1;
+}
+
+int NextStartupRecord(StartupRecordReader* reader, StartupRecord* record)
+{
+    if (reader->offset + sizeof(StartupRecordHeader) > reader->size)
+        return 0;
+
+    const StartupRecordHeader* header = (const StartupRecordHeader*)(reader->data + reader->offset);
+    size_t payloadSize = header->type == GTSPS_RECORD_PROCESS ? sizeof(StartupProcessRecord)
+                       : header->type == GTSPS_RECORD_MARK    ? sizeof(StartupEventRecord)
+                       : header->type == GTSPS_RECORD_SPAN    ? sizeof(StartupEventRecord)
+                       : header->type == GTSPS_RECORD_COUNTER ? sizeof(StartupCounterRecord)
+                       : header->type == GTSPS_RECORD_MODULE  ? sizeof(StartupModuleRecord)
+                       : 0;
+    if (header->size % 8 != 0 || reader->offset + header->size > reader->size ||
+        sizeof(*header) + payloadSize + header->nameLength + 1 > header->size)
+    {
+        // A truncated or corrupt record, e.g. a write in progress
+        return 0;
+    }
+
+    // The name must end inside the record
+    const char* data = reader->data + reader->offset + sizeof(*header);
+    if (data[payloadSize + header->nameLength] != '\0')
+        return 0;
+
+    record->type = header->type;
+    record->data = data;
+    record->name = data + payloadSize;
+    reader->offset += header->size;
+    return 1;
+}
+
+void CloseStartupRecords(StartupRecordReader* reader)
+{
+    if (reader->data)
+    {
+#if defined(_WIN32)
+        UnmapViewOfFile(reader->data);
+#else
+        munmap((void*)reader->data, reader->size);
+#endif
+    }
+    memset(reader, 0, sizeof(*reader));
+}
+
+// @brief  Checks the parents of a loaded timeline. Events are in the order they
+//         started, so a parent precedes its children: this also rules out cycles.
+//
+// @return 1 if the timeline is consistent, 0 otherwise.
+static int gtsps_ValidateParents(const StartupTimeline* timeline)
+{
+    for (int i = 0; i < timeline->count; ++i)
+    {
+        int parent = timeline->events[i].parent;
+        if (parent < -1 || parent >= i)
+            return 0;
+    }
+    return 1;
+}
+
+// @brief  Loads the timeline of the first process in a records file.
+static int gtsps_LoadRecordsTimeline(const char* path, StartupTimeline* timeline)
+{
+    StartupRecordReader reader;
+    if (!OpenStartupRecords(path, &reader))
+        return 0;
+
+    StartupRecord record;
+    int capacity = 0;
+    if (NextStartupRecord(&reader, &record) && record.type == GTSPS_RECORD_PROCESS)
+        capacity = ((const StartupProcessRecord*)record.data)->eventCount;
+
+    // The file can't hold more events than records of the smallest event size
+    size_t maxEvents = reader.size / (sizeof(StartupRecordHeader) + sizeof(StartupEventRecord) + 8);
+    if (capacity < 0 || (size_t)capacity > maxEvents)
+    {
+        GTSPS_LOG_ERROR("Error: The records file is corrupt, invalid event count.\n");
+        CloseStartupRecords(&reader);
+        return 0;
+    }
+
+    // The names are copied, the timeline outlives the mapping
+    timeline->events = (StartupEvent*)calloc((size_t)capacity + 1, sizeof(StartupEvent));
+    timeline->names = (char*)malloc(reader.size);
+    if (!timeline->events || !timeline->names)
+    {
+        GTSPS_LOG_ERROR("Error: Failed to allocate the timeline.\n");
+        FreeStartupTimeline(timeline);
+        CloseStartupRecords(&reader);
+        return 0;
+    }
+
+    char* names = timeline->names;
+    while (timeline->count < capacity && NextStartupRecord(&reader, &record) && record.type != GTSPS_RECORD_PROCESS)
+    {
+        if (record.type != GTSPS_RECORD_MARK && record.type != GTSPS_RECORD_SPAN)
+            continue;
+
+        const StartupEventRecord* source = (const StartupEventRecord*)record.data;
+        StartupEvent* event = &timeline->events[timeline->count++];
+        size_t nameLength = strlen(record.name);
+        memcpy(names, record.name, nameLength + 1);
+        event->name = names;
+        names += nameLength + 1;
+        event->type = record.type == GTSPS_RECORD_MARK ? GTSPS_EVENT_MARK : GTSPS_EVENT_SPAN;
+        event->begin = source->begin;
+        event->end = source->end;
+        event->parent = source->parent;
+        event->thread = source->thread;
+        event->cpu = source->cpu;
+        event->counters = source->counters;
+    }
+    CloseStartupRecords(&reader);
+
+    if (!gtsps_ValidateParents(timeline))
+    {
+        GTSPS_LOG_ERROR("Error: The records file is corrupt, an event has an invalid parent.\n");
+        FreeStartupTimeline(timeline);
+        return 0;
+    }
+    return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Timeline files and comparison
+
+#define GTSPS_TIMELINE_HEADER "# GetTimeSinceProcessStart timeline v2\n"
+
+int SaveStartupTimeline(const char* path)
+{
+    FILE* file = fopen(path, "w");
+    if (!file)
+    {
+        GTSPS_LOG_ERROR("Error: Failed to create the timeline file.\n");
+        return 0;
+    }
+
+    int count = gtsps_PublishedEventCount();
+
+    fputs(GTSPS_TIMELINE_HEADER, file);
+    for (int i = 0; i < count; ++i)
+    {
+        const StartupEvent* event = &gtsps_events[i];
+        fprintf(file, "%d %d %d %d %.9f %.9f %llu %llu %llu %llu %llu %llu %llu %llu %llu ", event->type,
+                event->parent, event->thread, event->cpu, event->begin, event->end,
+                (unsigned long long)event->counters.minorFaults, (unsigned long long)event->counters.majorFaults,
+                (unsigned long long)event->counters.readBlocks, (unsigned long long)event->counters.writeBlocks,
+                (unsigned long long)event->counters.instructions, (unsigned long long)event->counters.cycles,
+                (unsigned long long)event->counters.cacheMisses, (unsigned long long)event->counters.taskClock,
+                (unsigned long long)event->counters.contextSwitches);
+        for (const char* c = event->name; *c; ++c)
+            fputc(*c == '\n' ? ' ' : *c, file);
+        fputc('\n', file);
+    }
+
+    int failed = ferror(file);
+    if (fclose(file) != 0 || failed)
+    {
+        GTSPS_LOG_ERROR("Error: Failed to write the timeline file.\n");
+        return 0;
+    }
+    return 1;
+}
+
+int LoadStartupTimeline(const char* path, StartupTimeline* timeline)
+{
+    memset(timeline, 0, sizeof(*timeline));
+
+    FILE* file = fopen(path, "r");
+    if (!file)
+    {
+        GTSPS_LOG_ERROR("Error: Failed to open the timeline file.\n");
+        return 0;
+    }
+
+    // The file size bounds the storage of the names
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char line[4096];
+    if (fileSize >= 8 && fread(line, 1, 8, file) == 8 && memcmp(line, GTSPS_RECORDS_MAGIC, 8) == 0)
+    {
+        fclose(file);
+        return gtsps_LoadRecordsTimeline(path, timeline);
+    }
+    fseek(file, 0, SEEK_SET);
+
+    if (fileSize <= 0 || !fgets(line, sizeof(line), file) || strcmp(line, GTSPS_TIMELINE_HEADER) != 0)
+    {
+        GTSPS_LOG_ERROR("Error: Not a timeline file.\n");
+        fclose(file);
+        return 0;
+    }
+
+    int capacity = 0;
+    while (fgets(line, sizeof(line), file))
+        ++capacity;
+    fseek(file, (long)strlen(GTSPS_TIMELINE_HEADER), SEEK_SET);
+
+    timeline->events = (StartupEvent*)calloc((size_t)capacity + 1, sizeof(StartupEvent));
+    timeline->names = (char*)malloc((size_t)fileSize);
+    if (!timeline->events || !timeline->names)
+    {
+        GTSPS_LOG_ERROR("Error: Failed to allocate the timeline.\n");
+        FreeStartupTimeline(timeline);
+        fclose(file);
+        return 0;
+    }
+
+    char* names = timeline->names;
+    while (timeline->count < capacity && fgets(line, sizeof(line), file))
+    {
+        StartupEvent* event = &timeline->events[timeline->count];
+        unsigned long long minorFaults, majorFaults, readBlocks, writeBlocks;
+        unsigned long long instructions, cycles, cacheMisses, taskClock, contextSwitches;
+        int nameOffset = 0;
+        if (sscanf(line, "%d %d %d %d %lf %lf %llu %llu %llu %llu %llu %llu %llu %llu %llu %n", &event->type,
+                   &event->parent, &event->thread, &event->cpu, &event->begin, &event->end, &minorFaults,
+                   &majorFaults, &readBlocks, &writeBlocks, &instructions, &cycles, &cacheMisses, &taskClock,
+                   &contextSwitches, &nameOffset) != 15 || nameOffset == 0)
+        {
+            GTSPS_LOG_ERROR("Error: Failed decoding the timeline file.\n");
+            FreeStartupTimeline(timeline);
+            fclose(file);
+            return 0;
+        }
+        event->counters.minorFaults     = minorFaults;
+        event->counters.majorFaults     = majorFaults;
+        event->counters.readBlocks      = readBlocks;
+        event->counters.writeBlocks     = writeBlocks;
+        event->counters.instructions    = instructions;
+        event->counters.cycles          = cycles;
+        event->counters.cacheMisses     = cacheMisses;
+        event->counters.taskClock       = taskClock;
+        event->counters.contextSwitches = contextSwitches;
+
+        size_t nameLength = strcspn(line + nameOffset, "\n");
+        memcpy(names, line + nameOffset, nameLength);
+        names[nameLength] = '\0';
+        event->name = names;
+        names += nameLength + 1;
+        ++timeline->count;
+    }
+    fclose(file);
+
+    if (!gtsps_ValidateParents(timeline))
+    {
+        GTSPS_LOG_ERROR("Error: The timeline file is corrupt, an event has an invalid parent.\n");
+        FreeStartupTimeline(timeline);
+        return 0;
+    }
+    return 1;
+}
+
+void FreeStartupTimeline(StartupTimeline* timeline)
+{
+    free(timeline->events);
+    free(timeline->names);
+    memset(timeline, 0, sizeof(*timeline));
+}
+
+// The events are matched across timelines by path, the name of the event under the
+// path of its parent, and by occurrence among the events with the same path. The
+// paths of both timelines are interned in one hash table, so that a path has the same
+// id in each.
+typedef struct gtsps_PathTable
+{
+    int*         slots;     //< Path ids, -1 for the empty slots
+    int*         parents;   //< Path id of the parent of each path, -1 at the root
+    const char** names;
+    uint32_t*    hashes;
+    int          count;
+    uint32_t     mask;
+} gtsps_PathTable;
+
+static int gtsps_InternPath(gtsps_PathTable* table, int parent, const char* name)
+{
+    // FNV-1a of the parent id and the name
+    uint32_t hash = (2166136261u ^ (uint32_t)(parent + 1)) * 16777619u;
+    for (const char* c = name; *c; ++c)
+        hash = (hash ^ (uint8_t)*c) * 16777619u;
+
+    for (uint32_t slot = hash & table->mask;; slot = (slot + 1) & table->mask)
+    {
+        int id = table->slots[slot];
+        if (id < 0)
+        {
+            id = table->count++;
+            table->slots[slot] = id;
+            table->parents[id] = parent;
+            table->names[id] = name;
+            table->hashes[id] = hash;
+            return id;
+        }
+        if (table->hashes[id] == hash && table->parents[id] == parent && strcmp(table->names[id], name) == 0)
+            return id;
+    }
+}
+
+// @brief  Finds the path of each event, and its own time: the duration of a span,
+//         excluding the spans nested in it.
+static void gtsps_EventPaths(const StartupTimeline* timeline, gtsps_PathTable* table, int* paths, double* selfTimes)
+{
+    for (int i = 0; i < timeline->count; ++i)
+    {
+        // A parent is recorded before its children, anything else is treated as a root
+        const StartupEvent* event = &timeline->events[i];
+        int parent = event->parent >= 0 && event->parent < i ? event->parent : -1;
+        paths[i] = gtsps_InternPath(table, parent >= 0 ? paths[parent] : -1, event->name);
+
+        int closed = event->type == GTSPS_EVENT_SPAN && event->end >= 0.0;
+        selfTimes[i] = closed ? event->end - event->begin : 0.0;
+        if (closed && parent >= 0 && timeline->events[parent].type == GTSPS_EVENT_SPAN &&
+            timeline->events[parent].end >= 0.0)
+            selfTimes[parent] -= event->end - event->begin;
+    }
+}
+
+static void gtsps_PrintDiffLine(FILE* out, const StartupTimeline* before, int beforeIndex, const double* beforeSelf,
+                                const StartupTimeline* after, int afterIndex, const double* afterSelf)
+{
+    const StartupTimeline* timeline = afterIndex >= 0 ? after : before;
+    const StartupEvent* reference = &timeline->events[afterIndex >= 0 ? afterIndex : beforeIndex];
+
+    // Bounded, in case the caller built the timeline with a cycle
+    int depth = 0;
+    for (int parent = reference->parent; parent >= 0 && parent < timeline->count && depth < 64;
+         parent = timeline->events[parent].parent)
+        ++depth;
+
+    // Spans compare durations, marks compare when they happened
+    const StartupTimeline* timelines[2] = { before, after };
+    const double* self[2] = { beforeSelf, afterSelf };
+    int indices[2] = { beforeIndex, afterIndex };
+    double values[2] = { 0.0, 0.0 };
+    double selfTimes[2] = { 0.0, 0.0 };
+    long long faults[2] = { 0, 0 };
+    long long blocks[2] = { 0, 0 };
+    for (int i = 0; i < 2; ++i)
+    {
+        if (indices[i] < 0)
+            continue;
+        const StartupEvent* event = &timelines[i]->events[indices[i]];
+        values[i] = event->type == GTSPS_EVENT_MARK ? event->begin : event->end - event->begin;
+        selfTimes[i] = self[i][indices[i]];
+        faults[i] = (long long)(event->counters.minorFaults + event->counters.majorFaults);
+        blocks[i] = (long long)(event->counters.readBlocks + event->counters.writeBlocks);
+    }
+
+    const char* status = beforeIndex < 0 ? "NEW " : afterIndex < 0 ? "GONE" : "    ";
+    fprintf(out, "%s %10.6f %10.6f %+10.6f %+10.6f %+9lld %+9lld  %*s%s%s\n", status, values[0], values[1],
+            values[1] - values[0], selfTimes[1] - selfTimes[0], faults[1] - faults[0], blocks[1] - blocks[0],
+            depth * 2, "", reference->name, reference->type == GTSPS_EVENT_MARK ? " (mark)" : "");
+}
+
+void PrintStartupTimelineDiff(const StartupTimeline* before, const StartupTimeline* after, FILE* out)
+{
+    size_t total = (size_t)before->count + (size_t)after->count + 1;
+    size_t capacity = 16;
+    while (capacity < total * 2)
+        capacity *= 2;
+
+    gtsps_PathTable table;
+    table.slots = (int*)malloc(capacity * sizeof(int));
+    table.parents = (int*)malloc(total * sizeof(int));
+    table.names = (const char**)malloc(total * sizeof(const char*));
+    table.hashes = (uint32_t*)malloc(total * sizeof(uint32_t));
+    table.count = 0;
+    table.mask = (uint32_t)capacity - 1;
+    int* paths = (int*)malloc(total * sizeof(int));             //< Of before, then of after
+    double* selfTimes = (double*)malloc(total * sizeof(double));
+    int* matches = (int*)malloc(total * sizeof(int));           //< The after index of each before event
+    int* pathStarts = (int*)calloc(total + 1, sizeof(int));     //< Of the before events of each path in byPath
+    int* occurrences = (int*)calloc(total, sizeof(int));
+    int* byPath = (int*)malloc(total * sizeof(int));            //< The before events, grouped by path
+    if (!table.slots || !table.parents || !table.names || !table.hashes || !paths || !selfTimes || !matches ||
+        !pathStarts || !occurrences || !byPath)
+    {
+        GTSPS_LOG_ERROR("Error: Failed to allocate the timeline comparison.\n");
+    }
+    else
+    {
+        memset(table.slots, 0xff, capacity * sizeof(int));
+        int* beforePaths = paths;
+        int* afterPaths = paths + before->count;
+        double* beforeSelf = selfTimes;
+        double* afterSelf = selfTimes + before->count;
+        gtsps_EventPaths(before, &table, beforePaths, beforeSelf);
+        gtsps_EventPaths(after, &table, afterPaths, afterSelf);
+
+        // Group the events of before by path, in order of occurrence
+        for (int j = 0; j < before->count; ++j)
+            ++pathStarts[beforePaths[j] + 1];
+        for (int id = 0; id < table.count; ++id)
+            pathStarts[id + 1] += pathStarts[id];
+        for (int j = 0; j < before->count; ++j)
+        {
+            byPath[pathStarts[beforePaths[j]] + occurrences[beforePaths[j]]++] = j;
+            matches[j] = -1;
+        }
+        memset(occurrences, 0, total * sizeof(int));
+
+        fprintf(out, "Startup timeline diff (after - before), times in seconds\n");
+        fprintf(out, "%4s %10s %10s %10s %10s %9s %9s  %s\n", "", "before", "after", "delta", "self delta",
+                "faults", "blocks", "name");
+
+        // Walk the new timeline, then list the phases that disappeared
+        double worstDelta = 0.0;
+        const char* worstName = NULL;
+        for (int i = 0; i < after->count; ++i)
+        {
+            int path = afterPaths[i];
+            int occurrence = occurrences[path]++;
+            int match = occurrence < pathStarts[path + 1] - pathStarts[path] ? byPath[pathStarts[path] + occurrence]
+                                                                             : -1;
+            if (match >= 0)
+                matches[match] = i;
+
+            gtsps_PrintDiffLine(out, before, match, beforeSelf, after, i, afterSelf);
+
+            double selfDelta = afterSelf[i] - (match >= 0 ? beforeSelf[match] : 0.0);
+            if (after->events[i].type == GTSPS_EVENT_SPAN && selfDelta >= GTSPS_DIFF_MIN_REGRESSION &&
+                selfDelta > worstDelta)
+            {
+                worstDelta = selfDelta;
+                worstName = after->events[i].name;
+            }
+        }
+        for (int j = 0; j < before->count; ++j)
+        {
+            if (matches[j] < 0)
+                gtsps_PrintDiffLine(out, before, j, beforeSelf, after, -1, afterSelf);
+        }
+
+        if (worstName)
+            fprintf(out, "Largest regression: \"%s\" %+.6f seconds of its own time\n", worstName, worstDelta);
+        else
+            fprintf(out, "No phase regressed by %.6f seconds or more\n", (double)GTSPS_DIFF_MIN_REGRESSION);
+    }
+
+    free(table.slots);
+    free(table.parents);
+    free((void*)table.names);
+    free(table.hashes);
+    free(paths);
+    free(selfTimes);
+    free(matches);
+    free(pathStarts);
+    free(occurrences);
+    free(byPath);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// pprof export
+
+static void gtsps_BufferAppend(gtsps_Buffer* buffer, const void* data, size_t size)
+{
+    if (buffer->size + size > buffer->capacity)
+    {
+        size_t capacity = (buffer->capacity ? buffer->capacity * 2 : 4096) + size;
+        char* grown = (char*)realloc(buffer->data, capacity);
+        if (!grown)
+        {
+            buffer->failed = 1;
+            return;
+        }
+        buffer->data = grown;
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+}
+
+// Protocol buffers wire format: varints, and length delimited fields for strings,
+// nested messages and packed repeated numbers.
+static void gtsps_ProtoVarint(gtsps_Buffer* buffer, uint64_t value)
+{
+    uint8_t bytes[10];
+    size_t size = 0;
+    do
+    {
+        bytes[size++] = (uint8_t)((value & 0x7f) | (value > 0x7f ? 0x80 : 0));
+        value >>= 7;
+    } while (value);
+    gtsps_BufferAppend(buffer, bytes, size);
+}
+
+static void gtsps_ProtoInt(gtsps_Buffer* buffer, int field, uint64_t value)
+{
+    gtsps_ProtoVarint(buffer, (uint64_t)field << 3);
+    gtsps_ProtoVarint(buffer, value);
+}
+
+static void gtsps_ProtoBytes(gtsps_Buffer* buffer, int field, const void* data, size_t size)
+{
+    gtsps_ProtoVarint(buffer, (uint64_t)field << 3 | 2);
+    gtsps_ProtoVarint(buffer, size);
+    gtsps_BufferAppend(buffer, data, size);
+}
+
+// @brief  Appends a message encoded in a scratch buffer as a field, then clears the
+//         scratch buffer for the next message.
+static void gtsps_ProtoMessage(gtsps_Buffer* buffer, int field, gtsps_Buffer* message)
+{
+    gtsps_ProtoBytes(buffer, field, message->data, message->size);
+    buffer->failed |= message->failed;
+    message->size = 0;
+}
+
+// @brief  The wall clock in nanoseconds since the Unix epoch.
+static int64_t gtsps_UnixTimeNanoseconds()
+{
+#if defined(_WIN32)
+    FILETIME systemTime;
+#   if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+    GetSystemTimePreciseAsFileTime(&systemTime);
+#   else
+    GetSystemTimeAsFileTime(&systemTime);
+#   endif
+
+    ULARGE_INTEGER converter;
+    converter.LowPart = systemTime.dwLowDateTime;
+    converter.HighPart = systemTime.dwHighDateTime;
+    return ((int64_t)converter.QuadPart - 116444736000000000LL) * 100; // From 1601 in 100-ns intervals
+#elif defined(__APPLE__) || defined(MACOSX) || defined(__MACOSX__)
+    struct timeval currentTime = { 0 };
+    gettimeofday(&currentTime, NULL);
+    return (int64_t)currentTime.tv_sec * 1000000000 + (int64_t)currentTime.tv_usec * 1000;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (int64_t)now.tv_sec * 1000000000 + (int64_t)now.tv_nsec;
+#endif
+}
+
+#define GTSPS_PROFILE_VALUES 7
+
+// An executable segment of a module that contains the code of spans named by address.
+typedef struct gtsps_ProfileMapping
+{
+    uint64_t start;
+    uint64_t limit;
+    uint64_t fileOffset;
+    char*    path;
+    char     buildId[41];   //< Hex, empty if the module has none
+} gtsps_ProfileMapping;
+
+typedef struct gtsps_ProfileMappings
+{
+    const uint64_t*       addresses;    //< Code address of each function, 0 if named
+    int*                  mappingIds;   //< Out: mapping of each function, 0 if none
+    int                   functionCount;
+    gtsps_ProfileMapping* mappings;
+    int                   count;
+    int                   failed;
+} gtsps_ProfileMappings;
+
+#if defined(linux) || defined(__linux__) || defined(__LINUX__)
+static int gtsps_AppendProfileMappings(gtsps_ModuleInfo* info, size_t infoSize, void* userData)
+{
+    (void)infoSize;
+    gtsps_ProfileMappings* mappings = (gtsps_ProfileMappings*)userData;
+    for (int i = 0; i < info->dlpi_phnum && !mappings->failed; ++i)
+    {
+        const ElfW(Phdr)* segment = &info->dlpi_phdr[i];
+        if (segment->p_type != PT_LOAD || !(segment->p_flags & PF_X))
+            continue;
+
+        uint64_t start = (uint64_t)(info->dlpi_addr + segment->p_vaddr);
+        uint64_t limit = start + segment->p_memsz;
+        int id = 0;
+        for (int j = 0; j < mappings->functionCount; ++j)
+        {
+            uint64_t address = mappings->addresses[j];
+            if (address < start || address >= limit)
+                continue;
+            if (!id)
+            {
+                // At most one mapping per function, the array has room for all of them
+                gtsps_ProfileMapping* mapping = &mappings->mappings[mappings->count];
+                memset(mapping, 0, sizeof(*mapping));
+                mapping->start = start;
+                mapping->limit = limit;
+                mapping->fileOffset = segment->p_offset;
+
+                const char* path = info->dlpi_name;
+                char executable[4096];
+                if (!path || !path[0])
+                {
+                    // The main program has no name, resolve it
+                    ssize_t length = readlink("/proc/self/exe", executable, sizeof(executable) - 1);
+                    executable[length > 0 ? length : 0] = '\0';
+                    path = executable;
+                }
+                mapping->path = (char*)malloc(strlen(path) + 1);
+                if (!mapping->path)
+                {
+                    mappings->failed = 1;
+                    break;
+                }
+                strcpy(mapping->path, path);
+
+                uint8_t buildId[20];
+                uint32_t buildIdSize = gtsps_ModuleBuildId(info, buildId, sizeof(buildId));
+                for (uint32_t k = 0; k < buildIdSize; ++k)
+                    snprintf(mapping->buildId + 2 * k, 3, "%02x", buildId[k]);
+                id = ++mappings->count;
+            }
+            mappings->mappingIds[j] = id;
+        }
+    }
+    return 0;
+}
+#endif
+
+static void gtsps_ProfileValues(const StartupEvent* event, int64_t* values)
+{
+    values[0] = (int64_t)((event->end - event->begin) * 1e9);
+    values[1] = (int64_t)event->counters.taskClock;
+    values[2] = (int64_t)(event->counters.minorFaults + event->counters.majorFaults);
+    values[3] = (int64_t)(event->counters.readBlocks + event->counters.writeBlocks);
+    values[4] = (int64_t)event->counters.instructions;
+    values[5] = (int64_t)event->counters.cycles;
+    values[6] = (int64_t)event->counters.cacheMisses;
+}
+
+int SaveStartupProfile(const char* path)
+{
+    static const char* const valueTypes[GTSPS_PROFILE_VALUES][2] = {
+        { "wall", "nanoseconds" },  { "cpu", "nanoseconds" },    { "faults", "count" },
+        { "io_blocks", "count" },   { "instructions", "count" }, { "cycles", "count" },
+        { "cache_misses", "count" },
+    };
+
+    int count = gtsps_PublishedEventCount();
+    double now = gtsps_TimelineNow();
+    int64_t startTime = gtsps_UnixTimeNanoseconds() - (int64_t)(now * 1e9);
+
+    gtsps_Buffer profile, message, packed;
+    memset(&profile, 0, sizeof(profile));
+    memset(&message, 0, sizeof(message));
+    memset(&packed, 0, sizeof(packed));
+
+    // One location per span name,  and one function per name that isn't a code address.
+    // The string table starts with "", the value types and the thread label
+    int* functions = (int*)malloc(((size_t)count + 1) * sizeof(int));
+    int* functionEvents = (int*)malloc(((size_t)count + 1) * sizeof(int));
+    uint64_t* addresses = (uint64_t*)calloc((size_t)count + 1, sizeof(uint64_t));
+    int* mappingIds = (int*)calloc((size_t)count + 1, sizeof(int));
+    int functionCount = 0;
+    const int firstName = 1 + 2 * GTSPS_PROFILE_VALUES + 1;
+    if (!functions || !functionEvents || !addresses || !mappingIds)
+        profile.failed = 1;
+
+    for (int i = 0; i < count && !profile.failed; ++i)
+    {
+        const StartupEvent* event = &gtsps_events[i];
+        if (event->type != GTSPS_EVENT_SPAN)
+            continue;
+        int function = 0;
+        while (function < functionCount && strcmp(gtsps_events[functionEvents[function]].name, event->name) != 0)
+            ++function;
+        if (function == functionCount)
+        {
+            // Spans named by StartupSpanBeginAt() keep the code address
+            char* end = NULL;
+            if (strncmp(event->name, "0x", 2) == 0)
+                addresses[function] = strtoull(event->name + 2, &end, 16);
+            if (!end || *end)
+                addresses[function] = 0;
+            functionEvents[functionCount++] = i;
+        }
+        functions[i] = function + 1;
+    }
+
+    // The code addresses are exported as locations in the mappings of the modules, with
+    // their build-id, for pprof to symbolize them from the binaries
+    gtsps_ProfileMappings mappings;
+    memset(&mappings, 0, sizeof(mappings));
+#if defined(linux) || defined(__linux__) || defined(__LINUX__)
+    mappings.addresses = addresses;
+    mappings.mappingIds = mappingIds;
+    mappings.functionCount = functionCount;
+    mappings.mappings = (gtsps_ProfileMapping*)malloc(((size_t)functionCount + 1) * sizeof(gtsps_ProfileMapping));
+    if (!profile.failed && mappings.mappings)
+        dl_iterate_phdr(gtsps_AppendProfileMappings, &mappings);
+    profile.failed |= mappings.failed || !mappings.mappings;
+#endif
+    const int firstMappingName = firstName + functionCount;
+
+    for (int i = 0; i < GTSPS_PROFILE_VALUES && !profile.failed; ++i)
+    {
+        gtsps_ProtoInt(&message, 1, (uint64_t)(1 + 2 * i));
+        gtsps_ProtoInt(&message, 2, (uint64_t)(2 + 2 * i));
+        gtsps_ProtoMessage(&profile, 1, &message);
+    }
+
+    // A sample per closed span, its values exclude the nested spans
+    for (int i = 0; i < count && !profile.failed; ++i)
+    {
+        const StartupEvent* event = &gtsps_events[i];
+        if (event->type != GTSPS_EVENT_SPAN || event->end < 0.0)
+            continue;
+
+        for (int parent = i; parent >= 0; parent = gtsps_events[parent].parent)
+            gtsps_ProtoVarint(&packed, (uint64_t)functions[parent]);
+        gtsps_ProtoMessage(&message, 1, &packed);
+
+        int64_t values[GTSPS_PROFILE_VALUES], nested[GTSPS_PROFILE_VALUES];
+        gtsps_ProfileValues(event, values);
+        for (int j = i + 1; j < count; ++j)
+        {
+            const StartupEvent* child = &gtsps_events[j];
+            if (child->parent != i || child->type != GTSPS_EVENT_SPAN || child->end < 0.0)
+                continue;
+            gtsps_ProfileValues(child, nested);
+            for (int k = 0; k < GTSPS_PROFILE_VALUES; ++k)
+                values[k] -= nested[k];
+        }
+        for (int k = 0; k < GTSPS_PROFILE_VALUES; ++k)
+            gtsps_ProtoVarint(&packed, (uint64_t)(values[k] > 0 ? values[k] : 0));
+        gtsps_ProtoMessage(&message, 2, &packed);
+
+        gtsps_ProtoInt(&packed, 1, (uint64_t)(firstName - 1)); // "thread"
+        gtsps_ProtoInt(&packed, 3, (uint64_t)event->thread);
+        gtsps_ProtoMessage(&message, 3, &packed);
+        gtsps_ProtoMessage(&profile, 2, &message);
+    }
+
+    for (int i = 0; i < mappings.count && !profile.failed; ++i)
+    {
+        const gtsps_ProfileMapping* mapping = &mappings.mappings[i];
+        gtsps_ProtoInt(&message, 1, (uint64_t)(i + 1));
+        gtsps_ProtoInt(&message, 2, mapping->start);
+        gtsps_ProtoInt(&message, 3, mapping->limit);
+        gtsps_ProtoInt(&message, 4, mapping->fileOffset);
+        gtsps_ProtoInt(&message, 5, (uint64_t)(firstMappingName + 2 * i));
+        gtsps_ProtoInt(&message, 6, (uint64_t)(firstMappingName + 2 * i + 1));
+        gtsps_ProtoMessage(&profile, 3, &message);  // Mapping
+    }
+
+    // The function ids are dense, pprof numbers the functions it symbolizes after them
+    for (int i = 0, functionId = 0; i < functionCount && !profile.failed; ++i)
+    {
+        gtsps_ProtoInt(&message, 1, (uint64_t)(i + 1));
+        if (mappingIds[i])
+        {
+            // Left to symbolize: no line nor function
+            gtsps_ProtoInt(&message, 2, (uint64_t)mappingIds[i]);
+            gtsps_ProtoInt(&message, 3, addresses[i]);
+            gtsps_ProtoMessage(&profile, 4, &message);  // Location
+            continue;
+        }
+        gtsps_ProtoInt(&packed, 1, (uint64_t)++functionId);
+        gtsps_ProtoMessage(&message, 4, &packed);   // Line, function_id
+        gtsps_ProtoMessage(&profile, 4, &message);  // Location
+
+        gtsps_ProtoInt(&message, 1, (uint64_t)functionId);
+        gtsps_ProtoInt(&message, 2, (uint64_t)(firstName + i));
+        gtsps_ProtoInt(&message, 3, (uint64_t)(firstName + i));
+        gtsps_ProtoMessage(&profile, 5, &message);  // Function
+    }
+
+    gtsps_ProtoBytes(&profile, 6, "", 0);
+    for (int i = 0; i < GTSPS_PROFILE_VALUES; ++i)
+    {
+        gtsps_ProtoBytes(&profile, 6, valueTypes[i][0], strlen(valueTypes[i][0]));
+        gtsps_ProtoBytes(&profile, 6, valueTypes[i][1], strlen(valueTypes[i][1]));
+    }
+    gtsps_ProtoBytes(&profile, 6, "thread", 6);
+    for (int i = 0; i < functionCount && !profile.failed; ++i)
+    {
+        const char* name = gtsps_events[functionEvents[i]].name;
+        gtsps_ProtoBytes(&profile, 6, name, strlen(name));
+    }
+    for (int i = 0; i < mappings.count && !profile.failed; ++i)
+    {
+        gtsps_ProtoBytes(&profile, 6, mappings.mappings[i].path, strlen(mappings.mappings[i].path));
+        gtsps_ProtoBytes(&profile, 6, mappings.mappings[i].buildId, strlen(mappings.mappings[i].buildId));
+    }
+
+    // The time range spans from the process start, the period is a nanosecond of wall
+    // time since the spans are measured rather than sampled
+    gtsps_ProtoInt(&profile, 9, (uint64_t)startTime);
+    gtsps_ProtoInt(&profile, 10, (uint64_t)(now * 1e9));
+    gtsps_ProtoInt(&message, 1, 1);
+    gtsps_ProtoInt(&message, 2, 2);
+    gtsps_ProtoMessage(&profile, 11, &message);
+    gtsps_ProtoInt(&profile, 12, 1);
+    gtsps_ProtoInt(&profile, 14, 1);
+
+    free(functions);
+    free(functionEvents);
+    free(addresses);
+    free(mappingIds);
+    for (int i = 0; i < mappings.count; ++i)
+        free(mappings.mappings[i].path);
+    free(mappings.mappings);
+    free(message.data);
+    free(packed.data);
+    if (profile.failed)
+    {
+        GTSPS_LOG_ERROR("Error: Failed to allocate the profile.\n");
+        free(profile.data);
+        return 0;
+    }
+
+    FILE* file = fopen(path, "wb");
+    size_t written = file ? fwrite(profile.data, 1, profile.size, file) : 0;
+    free(profile.data);
+    if (!file || fclose(file) != 0 || written != profile.size)
+    {
+        GTSPS_LOG_ERROR("Error: Failed to write the profile file.\n");
+        return 0;
+    }
+    return 1;
+}
+
+#undef GTSPS_PROFILE_VALUES
+#undef GTSPS_TIMELINE_HEADER
+#undef GTSPS_RECORDS_MAGIC
+
+///////////////////////////////////////////////////////////////////////////////
+// NUMA placement report
+
+#define GTSPS_MAX_NUMA_NODES 64
+
+typedef struct gtsps_Pool
+{
+    const char* name;
+    const void* address;
+    size_t      size;
+} gtsps_Pool;
+
+static gtsps_Pool gtsps_pools[GTSPS_MAX_TAGGED_POOLS];
+static GTSPS_ATOMIC(int) gtsps_poolCount;
+
+void StartupTagPool(const char* name, const void* address, size_t size)
+{
+    int index = GTSPS_ATOMIC_FETCH_ADD(&gtsps_poolCount, 1);
+    if (index >= GTSPS_MAX_TAGGED_POOLS)
+        return;
+
+    gtsps_pools[index].name = name;
+    gtsps_pools[index].address = address;
+    gtsps_pools[index].size = size;
+}
+
+#if defined(linux) || defined(__linux__) || defined(__LINUX__)
+static void gtsps_PrintNodePages(FILE* out, const uint64_t* pages, uint64_t pageSize)
+{
+    for (int node = 0; node < GTSPS_MAX_NUMA_NODES; ++node)
+    {
+        // Small mappings in kB, rather than rounded to 0.0MB
+        uint64_t bytes = pages[node] * pageSize;
+        if (bytes >= 1024 * 1024)
+            fprintf(out, " N%d=%.1fMB", node, (double)bytes / (1024.0 * 1024.0));
+        else if (bytes)
+            fprintf(out, " N%d=%llukB", node, (unsigned long long)(bytes / 1024));
+    }
+    fprintf(out, "\n");
+}
+
+static int gtsps_NodeOfCpu(int cpu)
+{
+    char path[128];
+    for (int node = 0; node < GTSPS_MAX_NUMA_NODES; ++node)
+    {
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/node%d", cpu, node);
+        if (access(path, F_OK) == 0)
+            return node;
+    }
+    return -1;
+}
+#endif
+
+void PrintStartupNumaReport(FILE* out)
+{
+#if defined(linux) || defined(__linux__) || defined(__LINUX__)
+    fprintf(out, "NUMA placement at %.6f seconds since process start\n", gtsps_TimelineNow());
+
+    // Per mapping, from the kernel accounting of the pages touched so far
+    FILE* numaMaps = fopen("/proc/self/numa_maps", "r");
+    if (numaMaps)
+    {
+        uint64_t totals[GTSPS_MAX_NUMA_NODES] = { 0 };
+        char line[4096];
+        while (fgets(line, sizeof(line), numaMaps))
+        {
+            uint64_t pages[GTSPS_MAX_NUMA_NODES] = { 0 };
+            uint64_t pageSize = 4096;
+            const char* kind = "anon";
+            char file[4096] = "";
+            unsigned long address = 0;
+            int resident = 0;
+
+            char* context = NULL;
+            for (char* token = strtok_r(line, " \n", &context); token; token = strtok_r(NULL, " \n", &context))
+            {
+                int node;
+                unsigned long long value;
+                if (address == 0 && sscanf(token, "%lx", &address) == 1)
+                    continue;
+                if (sscanf(token, "N%d=%llu", &node, &value) == 2 && node >= 0 && node < GTSPS_MAX_NUMA_NODES)
+                {
+                    pages[node] = value;
+                    resident |= value != 0;
+                }
+                else if (sscanf(token, "kernelpagesize_kB=%llu", &value) == 1)
+                    pageSize = value * 1024;
+                else if (strncmp(token, "file=", 5) == 0)
+                {
+                    snprintf(file, sizeof(file), "%s", token + 5);
+                    kind = file;
+                }
+                else if (strcmp(token, "heap") == 0 || strcmp(token, "stack") == 0)
+                    kind = token[0] == 'h' ? "heap" : "stack";
+            }
+            // Mappings with no resident pages only make the report longer
+            if (!resident)
+                continue;
+
+            fprintf(out, "  %012lx %-40s", address, kind);
+            gtsps_PrintNodePages(out, pages, pageSize);
+            for (int node = 0; node < GTSPS_MAX_NUMA_NODES; ++node)
+                totals[node] += pages[node] * pageSize / 4096;
+        }
+        fclose(numaMaps);
+
+        fprintf(out, "  %12s %-40s", "", "total");
+        gtsps_PrintNodePages(out, totals, 4096);
+    }
+    else
+        fprintf(out, "  /proc/self/numa_maps is not available, the kernel is built without NUMA\n");
+
+    // Per pool, querying the node of each page: pools often share a mapping
+    int poolCount = GTSPS_ATOMIC_LOAD(&gtsps_poolCount);
+    if (poolCount > GTSPS_MAX_TAGGED_POOLS)
+        poolCount = GTSPS_MAX_TAGGED_POOLS;
+    const uintptr_t pageSize = (uintptr_t)sysconf(_SC_PAGESIZE);
+    for (int i = 0; i < poolCount; ++i)
+    {
+        uint64_t pages[GTSPS_MAX_NUMA_NODES] = { 0 };
+        uint64_t untouched = 0;
+        uintptr_t begin = (uintptr_t)gtsps_pools[i].address & ~(pageSize - 1);
+        uintptr_t end = (uintptr_t)gtsps_pools[i].address + gtsps_pools[i].size;
+        while (begin < end)
+        {
+            enum { batchSize = 1024 };
+            void* batch[batchSize];
+            int status[batchSize];
+            unsigned long count = 0;
+            for (; count < batchSize && begin < end; ++count, begin += pageSize)
+                batch[count] = (void*)begin;
+
+            if (syscall(SYS_move_pages, 0, count, batch, NULL, status, 0) != 0)
+            {
+                untouched += count;
+                continue;
+            }
+            for (unsigned long page = 0; page < count; ++page)
+            {
+                if (status[page] >= 0 && status[page] < GTSPS_MAX_NUMA_NODES)
+                    ++pages[status[page]];
+                else
+                    ++untouched;
+            }
+        }
+        fprintf(out, "  pool %-43s", gtsps_pools[i].name);
+        if (untouched)
+            fprintf(out, " untouched=%.1fMB", (double)(untouched * pageSize) / (1024.0 * 1024.0));
+        gtsps_PrintNodePages(out, pages, pageSize);
+    }
+
+    // The CPUs the threads ran on while recording the timeline
+    int count = gtsps_PublishedEventCount();
+    for (int i = 0; i < count; ++i)
+    {
+        int seen = 0;
+        for (int j = 0; j < i && !seen; ++j)
+            seen = gtsps_events[j].thread == gtsps_events[i].thread && gtsps_events[j].cpu == gtsps_events[i].cpu;
+        if (seen)
+            continue;
+
+        int events = 0;
+        for (int j = i; j < count; ++j)
+            events += gtsps_events[j].thread == gtsps_events[i].thread && gtsps_events[j].cpu == gtsps_events[i].cpu;
+        fprintf(out, "  thread %-8d cpu %-4d node %-3d %d events, first \"%s\"\n", gtsps_events[i].thread,
+                gtsps_events[i].cpu, gtsps_NodeOfCpu(gtsps_events[i].cpu), events, gtsps_events[i].name);
+    }
+#else
+    fprintf(out, "NUMA placement report is only available on Linux\n");
+#endif
+}
+
+#undef GTSPS_MAX_NUMA_NODES
+
+#else
+// The names are not stored, the spans are compiled out
+static const char* gtsps_CopyName(const char* name, const char* fallback)
+{
+    (void)fallback;
+    return name;
+}
+
+void StartupReady()
+{
+#if defined(GTSPS_ENABLE_INIT_MEMORY)
+    StartupReleaseInitMemory();
+#endif
+}
+#endif // GTSPS_DISABLE_INSTRUMENTATION
+
+///////////////////////////////////////////////////////////////////////////////
+// Asynchronous file loading
+#ifdef GTSPS_ENABLE_ASYNC_IO
+
+// On Linux the files are read through io_uring: a single thread opens the files and
+// keeps up to GTSPS_ASYNC_IO_DEPTH reads in flight, instead of one blocking read per
+// worker thread. The ring is driven with raw syscalls, without liburing. Kernels and
+// sandboxes without io_uring, e.g. seccomp filters denying io_uring_setup(),  and the
+// other platforms, fall back to the pool of GTSPS_ASYNC_IO_THREADS workers.
+#if defined(__NR_io_uring_setup) && defined(IORING_FEAT_RW_CUR_POS)
+#   define GTSPS_IO_URING 1
+#endif
+
+// The state of a file in the batch, a file is loaded by whoever claims it first
+// between the workers and the thread waiting for it.
+#define GTSPS_FILE_PENDING 0
+#define GTSPS_FILE_LOADING 1
+#define GTSPS_FILE_READY   2
+
+typedef struct gtsps_File
+{
+    const char*       path;
+    void*             data;
+    size_t            size;
+    GTSPS_ATOMIC(int) state;
+} gtsps_File;
+
+#ifdef GTSPS_IO_URING
+typedef struct gtsps_Ring
+{
+    int                  fd;
+    unsigned             entries;
+    unsigned*            sqHead;
+    unsigned*            sqTail;
+    unsigned*            sqMask;
+    unsigned*            sqArray;
+    unsigned*            cqHead;
+    unsigned*            cqTail;
+    unsigned*            cqMask;
+    struct io_uring_sqe* sqes;
+    struct io_uring_cqe* cqes;
+    void*                sqMemory;
+    size_t               sqMemorySize;
+    void*                cqMemory;
+    size_t               cqMemorySize;
+    size_t               sqesSize;
+} gtsps_Ring;
+
+// A read in flight, the index of the file is the user data of the request
+typedef struct gtsps_RingRead
+{
+    int    fd;
+    char*  data;
+    size_t size;        //< Size of the file
+    size_t offset;      //< Bytes read so far
+    double begin;       //< Time of the submission, the begin of the span
+} gtsps_RingRead;
+#endif
+
+struct StartupFileBatch
+{
+    gtsps_File*       files;
+    int               count;
+    GTSPS_ATOMIC(int) next;     //< Next file for the workers to claim
+    int               threadCount;
+#if defined(_WIN32)
+    HANDLE            threads[GTSPS_ASYNC_IO_THREADS];
+    SRWLOCK           lock;     //< Guards the READY transitions, for the threads waiting
+    CONDITION_VARIABLE ready;
+#else
+    pthread_t         threads[GTSPS_ASYNC_IO_THREADS];
+    pthread_mutex_t   lock;     //< Guards the READY transitions, for the threads waiting
+    pthread_cond_t    ready;
+#endif
+#ifdef GTSPS_IO_URING
+    gtsps_Ring        ring;     //< The ring when io_uring is available, fd -1 otherwise
+#endif
+};
+
+// @brief  Publishes the content of a loaded file and wakes up the threads waiting.
+static void gtsps_FinishFile(StartupFileBatch* batch, gtsps_File* file, char* data, size_t size)
+{
+    if (data)
+        data[size] = '\0';
+    else
+        GTSPS_LOG_ERROR("Error: Failed to load a file of the batch.\n");
+
+    file->data = data;
+    file->size = size;
+#if defined(_WIN32)
+    AcquireSRWLockExclusive(&batch->lock);
+    GTSPS_ATOMIC_STORE(&file->state, GTSPS_FILE_READY);
+    ReleaseSRWLockExclusive(&batch->lock);
+    WakeAllConditionVariable(&batch->ready);
+#else
+    pthread_mutex_lock(&batch->lock);
+    GTSPS_ATOMIC_STORE(&file->state, GTSPS_FILE_READY);
+    pthread_cond_broadcast(&batch->ready);
+    pthread_mutex_unlock(&batch->lock);
+#endif
+}
+
+static void gtsps_LoadFile(StartupFileBatch* batch, gtsps_File* file)
+{
+    int span = StartupSpanBegin(gtsps_CopyName(file->path, "load file"));
+
+    char* data = NULL;
+    size_t size = 0;
+#if defined(_WIN32)
+    HANDLE handle = CreateFileA(file->path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (handle != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER fileSize;
+        if (GetFileSizeEx(handle, &fileSize) && (data = (char*)malloc((size_t)fileSize.QuadPart + 1)))
+        {
+            while (size < (size_t)fileSize.QuadPart)
+            {
+                DWORD bytesRead = 0;
+                DWORD chunk = (DWORD)((size_t)fileSize.QuadPart - size > 0x40000000 ? 0x40000000
+                                                                                    : (size_t)fileSize.QuadPart - size);
+                if (!ReadFile(handle, data + size, chunk, &bytesRead, NULL) || bytesRead == 0)
+                    break;
+                size += bytesRead;
+            }
+        }
+        CloseHandle(handle);
+    }
+#else
+    int fd = open(file->path, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0)
+    {
+        struct stat info;
+        if (fstat(fd, &info) == 0 && (data = (char*)malloc((size_t)info.st_size + 1)))
+        {
+            while (size < (size_t)info.st_size)
+            {
+                ssize_t bytesRead = read(fd, data + size, (size_t)info.st_size - size);
+                if (bytesRead <= 0)
+                    break;
+                size += (size_t)bytesRead;
+            }
+        }
+        close(fd);
+    }
+#endif
+
+    StartupSpanEnd(span);
+    gtsps_FinishFile(batch, file, data, size);
+}
+
+static int gtsps_ClaimFile(gtsps_File* file)
+{
+    int expected = GTSPS_FILE_PENDING;
+    return GTSPS_ATOMIC_CAS(&file->state, &expected, GTSPS_FILE_LOADING);
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI gtsps_FileWorker(LPVOID arg)
+#else
+static void* gtsps_FileWorker(void* arg)
+#endif
+{
+    StartupFileBatch* batch = (StartupFileBatch*)arg;
+    for (;;)
+    {
+        int index = GTSPS_ATOMIC_FETCH_ADD(&batch->next, 1);
+        if (index >= batch->count)
+            break;
+        if (gtsps_ClaimFile(&batch->files[index]))
+            gtsps_LoadFile(batch, &batch->files[index]);
+    }
+    return 0;
+}
+
+#ifdef GTSPS_IO_URING
+static void gtsps_CloseRing(gtsps_Ring* ring)
+{
+    if (ring->sqes)
+        munmap(ring->sqes, ring->sqesSize);
+    if (ring->cqMemory)
+        munmap(ring->cqMemory, ring->cqMemorySize);
+    if (ring->sqMemory)
+        munmap(ring->sqMemory, ring->sqMemorySize);
+    if (ring->fd >= 0)
+        close(ring->fd);
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+}
+
+// @brief  Sets up a ring of the given depth and maps its queues.
+//
+// @return 1 on success, 0 when io_uring is not available.
+static int gtsps_OpenRing(gtsps_Ring* ring, unsigned entries)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0)
+    {
+        ring->fd = -1;
+        return 0;
+    }
+    ring->entries = params.sq_entries;
+
+    // The queues are mapped separately, which kernels with IORING_FEAT_SINGLE_MMAP accept too
+    ring->sqMemorySize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqMemorySize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqMemory = mmap(NULL, ring->sqMemorySize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                          IORING_OFF_SQ_RING);
+    ring->cqMemory = mmap(NULL, ring->cqMemorySize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                          IORING_OFF_CQ_RING);
+    ring->sqes = (struct io_uring_sqe*)mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                            ring->fd, IORING_OFF_SQES);
+    if (ring->sqMemory == MAP_FAILED || ring->cqMemory == MAP_FAILED || ring->sqes == MAP_FAILED)
+    {
+        if (ring->sqMemory == MAP_FAILED)
+            ring->sqMemory = NULL;
+        if (ring->cqMemory == MAP_FAILED)
+            ring->cqMemory = NULL;
+        if (ring->sqes == MAP_FAILED)
+            ring->sqes = NULL;
+        gtsps_CloseRing(ring);
+        return 0;
+    }
+
+    char* sq = (char*)ring->sqMemory;
+    char* cq = (char*)ring->cqMemory;
+    ring->sqHead  = (unsigned*)(sq + params.sq_off.head);
+    ring->sqTail  = (unsigned*)(sq + params.sq_off.tail);
+    ring->sqMask  = (unsigned*)(sq + params.sq_off.ring_mask);
+    ring->sqArray = (unsigned*)(sq + params.sq_off.array);
+    ring->cqHead  = (unsigned*)(cq + params.cq_off.head);
+    ring->cqTail  = (unsigned*)(cq + params.cq_off.tail);
+    ring->cqMask  = (unsigned*)(cq + params.cq_off.ring_mask);
+    ring->cqes    = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    return 1;
+}
+
+// @brief  Queues the read of the rest of a file, the caller submits the queue.
+static void gtsps_QueueRead(gtsps_Ring* ring, const gtsps_RingRead* read, int index)
+{
+    // The ring is only written by this thread, the kernel consumes up to the tail
+    unsigned tail = *ring->sqTail;
+    unsigned slot = tail & *ring->sqMask;
+    size_t remaining = read->size - read->offset;
+
+    struct io_uring_sqe* sqe = &ring->sqes[slot];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = read->fd;
+    sqe->off = read->offset;
+    sqe->addr = (uint64_t)(uintptr_t)(read->data + read->offset);
+    sqe->len = (uint32_t)(remaining > 0x40000000 ? 0x40000000 : remaining);
+    sqe->user_data = (uint64_t)index;
+    ring->sqArray[slot] = slot;
+    __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+}
+
+// @brief  Records a span that began earlier on the calling thread,  without opening
+//         it: the loads completing on the ring thread overlap, they don't nest.
+static void gtsps_AddClosedSpan(const char* name, double begin)
+{
+#ifndef GTSPS_DISABLE_INSTRUMENTATION
+    StartupSpanEnd(gtsps_AddEventAt(name, GTSPS_EVENT_SPAN, begin));
+#else
+    (void)name;
+    (void)begin;
+#endif
+}
+
+// @brief  Reads the rest of a file synchronously, when the ring can't.
+static void gtsps_ReadRemainder(gtsps_RingRead* read)
+{
+    while (read->offset < read->size)
+    {
+        ssize_t bytesRead = pread(read->fd, read->data + read->offset, read->size - read->offset, (off_t)read->offset);
+        if (bytesRead <= 0)
+            break;
+        read->offset += (size_t)bytesRead;
+    }
+}
+
+static void gtsps_FinishRingRead(StartupFileBatch* batch, gtsps_RingRead* read, int index)
+{
+    gtsps_File* file = &batch->files[index];
+    if (read->fd >= 0)
+        close(read->fd);
+    gtsps_AddClosedSpan(gtsps_CopyName(file->path, "load file"), read->begin);
+    gtsps_FinishFile(batch, file, read->data, read->offset);
+    read->fd = -1;
+    read->data = NULL;
+}
+
+static void* gtsps_RingWorker(void* arg)
+{
+    StartupFileBatch* batch = (StartupFileBatch*)arg;
+    gtsps_Ring* ring = &batch->ring;
+    gtsps_RingRead* reads = (gtsps_RingRead*)calloc((size_t)batch->count, sizeof(gtsps_RingRead));
+    if (!reads)
+    {
+        // Without the table of the reads load the files one by one
+        gtsps_FileWorker(batch);
+        return 0;
+    }
+
+    unsigned inFlight = 0;
+    unsigned queued = 0;
+    int claiming = 1;
+    for (;;)
+    {
+        // Open the files claimed first and queue their reads, up to the depth of the ring
+        while (claiming && inFlight + queued < ring->entries)
+        {
+            int index = GTSPS_ATOMIC_FETCH_ADD(&batch->next, 1);
+            if (index >= batch->count)
+            {
+                claiming = 0;
+                break;
+            }
+            gtsps_File* file = &batch->files[index];
+            if (!gtsps_ClaimFile(file))
+                continue;
+
+            gtsps_RingRead* read = &reads[index];
+            read->begin = GetTimeSinceProcessStart();
+            read->fd = open(file->path, O_RDONLY | O_CLOEXEC);
+            struct stat info;
+            if (read->fd >= 0 && fstat(read->fd, &info) == 0)
+            {
+                read->size = (size_t)info.st_size;
+                read->data = (char*)malloc(read->size + 1);
+            }
+            if (!read->data || read->size == 0)
+            {
+                gtsps_FinishRingRead(batch, read, index);
+                continue;
+            }
+            gtsps_QueueRead(ring, read, index);
+            ++queued;
+        }
+        if (inFlight + queued == 0)
+            break;
+
+        long submitted = syscall(__NR_io_uring_enter, ring->fd, queued, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (submitted < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            // The requests stay queued in the ring: read them synchronously and stop
+            // using it, the rest of the files go through the blocking loop
+            GTSPS_LOG_ERROR("Error: Failed to submit reads to io_uring.\n");
+            break;
+        }
+        inFlight += (unsigned)submitted;
+        queued -= (unsigned)submitted;
+
+        unsigned head = *ring->cqHead;
+        unsigned tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head)
+        {
+            struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cqMask];
+            int index = (int)cqe->user_data;
+            int result = cqe->res;
+            gtsps_RingRead* read = &reads[index];
+            --inFlight;
+
+            if (result == -EINTR || result == -EAGAIN)
+            {
+                gtsps_QueueRead(ring, read, index);
+                ++queued;
+                continue;
+            }
+            if (result < 0)
+            {
+                // E.g. -EINVAL from kernels before 5.6 without IORING_OP_READ,  and
+                // file systems that don't support it: read the rest synchronously
+                gtsps_ReadRemainder(read);
+                result = 0;
+            }
+            read->offset += (size_t)result;
+            if (result > 0 && read->offset < read->size)
+            {
+                gtsps_QueueRead(ring, read, index);
+                ++queued;
+            }
+            else
+                gtsps_FinishRingRead(batch, read, index);
+        }
+        __atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+    }
+
+    // After a failure of the ring, complete the reads left behind synchronously
+    for (int index = 0; index < batch->count; ++index)
+    {
+        gtsps_RingRead* read = &reads[index];
+        if (!read->data)
+            continue;
+        gtsps_ReadRemainder(read);
+        gtsps_FinishRingRead(batch, read, index);
+    }
+    free(reads);
+    gtsps_FileWorker(batch);
+    return 0;
+}
+#endif
+
+StartupFileBatch* StartupLoadFilesAsync(const char* const* paths, int count)
+{
+    if (count <= 0)
+        return NULL;
+
+    // A single allocation for the batch, the file table and the copy of the paths
+    size_t pathsSize = 0;
+    for (int i = 0; i < count; ++i)
+        pathsSize += strlen(paths[i]) + 1;
+
+    size_t filesOffset = (sizeof(StartupFileBatch) + 15) & ~(size_t)15;
+    size_t pathsOffset = filesOffset + sizeof(gtsps_File) * (size_t)count;
+    char* memory = (char*)calloc(1, pathsOffset + pathsSize);
+    if (!memory)
+    {
+        GTSPS_LOG_ERROR("Error: Failed to allocate the file batch.\n");
+        return NULL;
+    }
+
+    StartupFileBatch* batch = (StartupFileBatch*)memory;
+    batch->files = (gtsps_File*)(memory + filesOffset);
+    batch->count = count;
+#if defined(_WIN32)
+    InitializeSRWLock(&batch->lock);
+    InitializeConditionVariable(&batch->ready);
+#else
+    pthread_mutex_init(&batch->lock, NULL);
+    pthread_cond_init(&batch->ready, NULL);
+#endif
+
+    char* path = memory + pathsOffset;
+    for (int i = 0; i < count; ++i)
+    {
+        size_t size = strlen(paths[i]) + 1;
+        memcpy(path, paths[i], size);
+        batch->files[i].path = path;
+        path += size;
+    }
+
+#ifdef GTSPS_IO_URING
+    unsigned depth = (unsigned)count < GTSPS_ASYNC_IO_DEPTH ? (unsigned)count : GTSPS_ASYNC_IO_DEPTH;
+    if (gtsps_OpenRing(&batch->ring, depth))
+    {
+        if (pthread_create(&batch->threads[0], NULL, gtsps_RingWorker, batch) == 0)
+        {
+            batch->threadCount = 1;
+            return batch;
+        }
+        gtsps_CloseRing(&batch->ring);
+    }
+#endif
+
+    int threadCount = count < GTSPS_ASYNC_IO_THREADS ? count : GTSPS_ASYNC_IO_THREADS;
+    for (int i = 0; i < threadCount; ++i)
+    {
+#if defined(_WIN32)
+        batch->threads[batch->threadCount] = CreateThread(NULL, 0, gtsps_FileWorker, batch, 0, NULL);
+        if (!batch->threads[batch->threadCount])
+            break;
+#else
+        if (pthread_create(&batch->threads[batch->threadCount], NULL, gtsps_FileWorker, batch) != 0)
+            break;
+#endif
+        ++batch->threadCount;
+    }
+    // Without workers the files are loaded on demand by StartupWaitForFile()
+    return batch;
+}
+
+const void* StartupWaitForFile(StartupFileBatch* batch, int index, size_t* size)
+{
+    if (!batch || index < 0 || index >= batch->count)
+        return NULL;
+
+    gtsps_File* file = &batch->files[index];
+    if (gtsps_ClaimFile(file))
+        gtsps_LoadFile(batch, file);
+    else if (GTSPS_ATOMIC_LOAD(&file->state) != GTSPS_FILE_READY)
+    {
+        // The state turns READY under the lock, the wake up can't be missed
+#if defined(_WIN32)
+        AcquireSRWLockExclusive(&batch->lock);
+        while (GTSPS_ATOMIC_LOAD(&file->state) != GTSPS_FILE_READY)
+            SleepConditionVariableSRW(&batch->ready, &batch->lock, INFINITE, 0);
+        ReleaseSRWLockExclusive(&batch->lock);
+#else
+        pthread_mutex_lock(&batch->lock);
+        while (GTSPS_ATOMIC_LOAD(&file->state) != GTSPS_FILE_READY)
+            pthread_cond_wait(&batch->ready, &batch->lock);
+        pthread_mutex_unlock(&batch->lock);
+#endif
+    }
+
+    if (size)
+        *size = file->size;
+    return file->data;
+}
+
+void StartupFreeFiles(StartupFileBatch* batch)
+{
+    if (!batch)
+        return;
+
+    for (int i = 0; i < batch->threadCount; ++i)
+    {
+#if defined(_WIN32)
+        WaitForSingleObject(batch->threads[i], INFINITE);
+        CloseHandle(batch->threads[i]);
+#else
+        pthread_join(batch->threads[i], NULL);
+#endif
+    }
+#ifdef GTSPS_IO_URING
+    gtsps_CloseRing(&batch->ring);
+#endif
+#if !defined(_WIN32)
+    pthread_cond_destroy(&batch->ready);
+    pthread_mutex_destroy(&batch->lock);
+#endif
+    for (int i = 0; i < batch->count; ++i)
+        free(batch->files[i].data);
+    free(batch);
+}
+
+#undef GTSPS_FILE_PENDING
+#undef GTSPS_FILE_LOADING
+#undef GTSPS_FILE_READY
+#undef GTSPS_IO_URING
+#endif // GTSPS_ENABLE_ASYNC_IO
+
+///////////////////////////////////////////////////////////////////////////////
+// Embedded runtimes
+
+void* StartupLoadLibrary(const char* path, int dlopenFlags)
+{
+    int span = StartupSpanBegin(gtsps_CopyName(path, "load library"));
+#if defined(_WIN32)
+    (void)dlopenFlags;
+    void* library = (void*)LoadLibraryA(path);
+#else
+    void* library = dlopen(path, dlopenFlags);
+#endif
+    StartupSpanEnd(span);
+
+    if (!library)
+        GTSPS_LOG_ERROR("Error: Failed to load a library.\n");
+    return library;
+}
+
+#if !defined(GTSPS_DISABLE_INSTRUMENTATION) && !defined(_WIN32)
+void* gtsps_NextSymbol(const char* symbol)
+{
+    return dlsym(RTLD_NEXT, symbol);
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Fork server
+#ifdef GTSPS_ENABLE_ZYGOTE
+
+typedef struct gtsps_ZygoteReply
+{
+    int32_t pid;
+    int32_t padding;
+    double  zygoteStartup;
+} gtsps_ZygoteReply;
+
+// Interrupts accept() when a worker exits, so that the zygote reaps it
+static void gtsps_ZygoteWorkerExited(int signal)
+{
+    (void)signal;
+}
+
+static int gtsps_ZygoteAddress(const char* socketPath, struct sockaddr_un* address)
+{
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    if (strlen(socketPath) >= sizeof(address->sun_path))
+    {
+        GTSPS_LOG_ERROR("Error: The zygote socket path is too long.\n");
+        return 0;
+    }
+    strcpy(address->sun_path, socketPath);
+    return 1;
+}
+
+int StartupZygoteServe(const char* socketPath, StartupZygoteWorker worker, void* userData)
+{
+    double zygoteStartup = GetTimeSinceProcessStart();
+
+    struct sockaddr_un address;
+    if (!gtsps_ZygoteAddress(socketPath, &address))
+        return -1;
+
+    int server = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (server < 0)
+    {
+        GTSPS_LOG_ERROR("Error: Failed to create the zygote socket.\n");
+        return -1;
+    }
+    unlink(socketPath);
+    if (bind(server, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(server, 64) != 0)
+    {
+        GTSPS_LOG_ERROR("Error: Failed to listen on the zygote socket.\n");
+        close(server);
+        return -1;
+    }
+
+    // The workers still running, the zygote doesn't reap the other children of the
+    // process, e.g. spawned by the initialization of the application
+    pid_t* workers = NULL;
+    int workerCount = 0;
+    int workerCapacity = 0;
+
+    // Without SA_RESTART, a worker exiting interrupts accept()
+    struct sigaction workerExited, previousAction;
+    memset(&workerExited, 0, sizeof(workerExited));
+    workerExited.sa_handler = gtsps_ZygoteWorkerExited;
+    sigemptyset(&workerExited.sa_mask);
+    sigaction(SIGCHLD, &workerExited, &previousAction);
+    StartupMark("zygote ready");
+
+    for (;;)
+    {
+        // Reap the workers that exited in the meantime
+        for (int i = 0; i < workerCount;)
+        {
+            pid_t result = waitpid(workers[i], NULL, WNOHANG);
+            if (result == workers[i] || (result < 0 && errno == ECHILD))
+                workers[i] = workers[--workerCount];
+            else
+                ++i;
+        }
+
+        int connection = accept(server, NULL, NULL);
+        if (connection < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            GTSPS_LOG_ERROR("Error: Failed to accept a zygote request.\n");
+            sigaction(SIGCHLD, &previousAction, NULL);
+            close(server);
+            free(workers);
+            return -1;
+        }
+
+        // A client that connects and never writes must not stall the zygote
+        struct timeval timeout;
+        timeout.tv_sec = GTSPS_ZYGOTE_REQUEST_TIMEOUT_MS / 1000;
+        timeout.tv_usec = (GTSPS_ZYGOTE_REQUEST_TIMEOUT_MS % 1000) * 1000;
+        setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        char request = 0;
+        if (read(connection, &request, 1) != 1)
+        {
+            close(connection);
+            continue;
+        }
+
+        if (workerCount == workerCapacity)
+        {
+            int capacity = workerCapacity ? workerCapacity * 2 : 16;
+            pid_t* grown = (pid_t*)realloc(workers, sizeof(pid_t) * (size_t)capacity);
+            if (!grown)
+            {
+                GTSPS_LOG_ERROR("Error: The zygote failed to track a new worker.\n");
+                close(connection);
+                continue;
+            }
+            workers = grown;
+            workerCapacity = capacity;
+        }
+
+        // Output buffered by the zygote would be written again by each worker exiting
+        fflush(NULL);
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            close(server);
+            free(workers);
+            sigaction(SIGCHLD, &previousAction, NULL);
+            StartupMark("zygote fork");
+
+            // The worker owns the connection, with blocking reads
+            timeout.tv_sec = 0;
+            timeout.tv_usec = 0;
+            setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+            gtsps_ZygoteReply reply;
+            reply.pid = (int32_t)getpid();
+            reply.padding = 0;
+            reply.zygoteStartup = zygoteStartup;
+            if (write(connection, &reply, sizeof(reply)) != (ssize_t)sizeof(reply))
+                _exit(1);
+
+            worker(connection, userData);
+            exit(0);
+        }
+        if (pid > 0)
+            workers[workerCount++] = pid;
+        else
+            GTSPS_LOG_ERROR("Error: The zygote failed to fork a worker.\n");
+        close(connection);
+    }
+}
+
+int StartupZygoteSpawn(const char* socketPath, StartupZygoteWorkerInfo* info)
+{
+    struct sockaddr_un address;
+    if (!gtsps_ZygoteAddress(socketPath, &address))
+        return -1;
+
+    double requestTime = gtsps_ReadClock();
+
+    int connection = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (connection < 0)
+    {
+        GTSPS_LOG_ERROR("Error: Failed to create the zygote socket.\n");
+        return -1;
+    }
+
+    char request = 'f';
+    gtsps_ZygoteReply reply;
+    size_t received = 0;
+    if (connect(connection, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        write(connection, &request, 1) != 1)
+    {
+        GTSPS_LOG_ERROR("Error: Failed to send the request to the zygote.\n");
+        close(connection);
+        return -1;
+    }
+    while (received < sizeof(reply))
+    {
+        ssize_t bytesRead = read(connection, (char*)&reply + received, sizeof(reply) - received);
+        if (bytesRead <= 0)
+        {
+            GTSPS_LOG_ERROR("Error: The zygote failed to start a worker.\n");
+            close(connection);
+            return -1;
+        }
+        received += (size_t)bytesRead;
+    }
+
+    if (info)
+    {
+        info->pid = reply.pid;
+        info->latency = gtsps_ReadClock() - requestTime;
+        info->zygoteStartup = reply.zygoteStartup;
+    }
+    return connection;
+}
+
+#endif // GTSPS_ENABLE_ZYGOTE
+
+///////////////////////////////////////////////////////////////////////////////
+// Launcher
+#if defined(GTSPS_ENABLE_LAUNCHER) && (defined(linux) || defined(__linux__) || defined(__LINUX__))
+
+#if defined(__GLIBC__)
+typedef enum __ptrace_request gtsps_PtraceRequest;
+#else
+typedef int gtsps_PtraceRequest;
+#endif
+
+// @brief  Tells which system call a tracee stopped at, with PTRACE_GET_SYSCALL_INFO
+//         (Linux 5.3). The layout is the one of the kernel ABI, older C libraries
+//         don't declare it.
+//
+// @return the system call number at the entry of a system call, -1 at its exit, -2
+//         if the kernel can't tell.
+static long gtsps_SyscallAtStop(pid_t pid)
+{
+    struct
+    {
+        uint8_t  op;
+        uint8_t  reserved[3];
+        uint32_t arch;
+        uint64_t instructionPointer;
+        uint64_t stackPointer;
+        uint64_t number;
+        uint64_t arguments[6];
+    } info;
+    if (ptrace((gtsps_PtraceRequest)0x420e /* PTRACE_GET_SYSCALL_INFO */, pid, (void*)sizeof(info), &info) <= 0)
+        return -2;
+    return info.op == 1 /* PTRACE_SYSCALL_INFO_ENTRY */ ? (long)info.number : -1;
+}
+
+int StartupLaunch(char* const argv[], StartupExecPhases* phases)
+{
+    memset(phases, 0, sizeof(*phases));
+
+    // The child reports when it starts running through a pipe, the other phases are
+    // observed at the ptrace stops.
+    int timePipe[2];
+    if (pipe(timePipe) != 0)
+    {
+        GTSPS_LOG_ERROR("Error: Failed to create the launcher pipe.\n");
+        return 0;
+    }
+    fcntl(timePipe[0], F_SETFD, FD_CLOEXEC);
+    fcntl(timePipe[1], F_SETFD, FD_CLOEXEC);
+
+    double forkTime = gtsps_ReadClock();
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        double runningTime = gtsps_ReadClock();
+        if (write(timePipe[1], &runningTime, sizeof(runningTime)) != (ssize_t)sizeof(runningTime))
+            _exit(127);
+        // Untraced, the stop below would never be reported to the launcher
+        if (ptrace(PTRACE_TRACEME, 0, NULL, NULL) != 0)
+            _exit(127);
+        raise(SIGSTOP);
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+    close(timePipe[1]);
+    if (pid < 0)
+    {
+        GTSPS_LOG_ERROR("Error: The launcher failed to fork.\n");
+        close(timePipe[0]);
+        return 0;
+    }
+
+    double runningTime = forkTime;
+    if (read(timePipe[0], &runningTime, sizeof(runningTime)) != (ssize_t)sizeof(runningTime))
+        runningTime = forkTime;
+    close(timePipe[0]);
+
+    double execveTime = 0.0, execDoneTime = 0.0, entryTime = 0.0;
+    int status = 0;
+    int tracing = 1;
+    int traced = 0;
+    int inSyscall = 0;
+    while (waitpid(pid, &status, 0) == pid)
+    {
+        if (WIFEXITED(status) || WIFSIGNALED(status))
+            break;
+        if (!WIFSTOPPED(status))
+            continue;
+
+        traced = 1;
+        double now = gtsps_ReadClock();
+        int signal = WSTOPSIG(status);
+        gtsps_PtraceRequest request = PTRACE_CONT;
+        int forwardedSignal = 0;
+        if (!tracing)
+            forwardedSignal = signal;
+        else if (signal == SIGSTOP && execveTime == 0.0)
+        {
+            // The child is about to call execvp(), stop at the next system call
+            ptrace(PTRACE_SETOPTIONS, pid, NULL,
+                   (void*)(long)(PTRACE_O_TRACEEXEC | PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL));
+            request = PTRACE_SYSCALL;
+        }
+        else if (signal == (SIGTRAP | 0x80))
+        {
+            // execvp() tries each directory of PATH until an execve() succeeds, stop at
+            // every system call until the exec event: the execve() that counts is the
+            // last one entered before it. Without the system call info, the entries are
+            // told from the exits by their parity, and any entry may be the execve().
+            long syscallNumber = gtsps_SyscallAtStop(pid);
+            inSyscall = syscallNumber == -2 ? !inSyscall : syscallNumber != -1;
+            if (inSyscall && (syscallNumber == SYS_execve || syscallNumber == -2))
+                execveTime = now;
+            request = PTRACE_SYSCALL;
+        }
+        else if (signal == SIGTRAP && (status >> 16) == PTRACE_EVENT_EXEC)
+        {
+            // The new image is loaded, step the first instruction of the loader
+            execDoneTime = now;
+            request = PTRACE_SINGLESTEP;
+        }
+        else if (signal == SIGTRAP && execDoneTime != 0.0)
+        {
+            entryTime = now;
+            ptrace(PTRACE_DETACH, pid, NULL, NULL);
+            tracing = 0;
+            continue;
+        }
+        else
+            forwardedSignal = signal;
+
+        ptrace(request, pid, NULL, (void*)(long)forwardedSignal);
+    }
+    double exitTime = gtsps_ReadClock();
+
+    if (!traced)
+    {
+        GTSPS_LOG_ERROR("Error: The launcher can't trace the program, is ptrace denied?\n");
+        return 0;
+    }
+    if (execDoneTime == 0.0)
+    {
+        GTSPS_LOG_ERROR("Error: The launched program failed to execute.\n");
+        return 0;
+    }
+    if (execveTime == 0.0)
+        execveTime = runningTime;
+    if (entryTime == 0.0)
+        entryTime = execDoneTime;
+
+    phases->fork = runningTime - forkTime;
+    phases->preExec = execveTime - runningTime;
+    phases->exec = execDoneTime - execveTime;
+    phases->loaderEntry = entryTime - execDoneTime;
+    phases->total = exitTime - forkTime;
+    phases->exitStatus = status;
+    return 1;
+}
+
+// @brief  Tells whether an environment entry assigns the variable.
+static int gtsps_AssignsVariable(const char* entry, const char* variable)
+{
+    size_t length = strlen(variable);
+    return strncmp(entry, variable, length) == 0 && entry[length] == '=';
+}
+
+// @brief  Runs the program once, until it reports the ready mark through a pipe or
+//         GTSPS_TUNE_TIMEOUT_MS expire. The thread count is passed in the environment
+//         of the program, the environment of the caller is left untouched.
+//
+// @return the time to ready in seconds, negative in case of error.
+static double gtsps_RunUntilReady(char* const argv[], const char* variable, int threads)
+{
+    int readyPipe[2];
+    if (pipe(readyPipe) != 0)
+        return -1.0;
+    fcntl(readyPipe[0], F_SETFD, FD_CLOEXEC);
+
+    // The environment of the caller, with the thread count and the ready pipe
+    size_t count = 0;
+    while (environ[count])
+        ++count;
+    char threadsEntry[256], readyEntry[32];
+    snprintf(threadsEntry, sizeof(threadsEntry), "%s=%d", variable, threads);
+    snprintf(readyEntry, sizeof(readyEntry), "GTSPS_READY_FD=%d", readyPipe[1]);
+    char** environment = (char**)malloc((count + 3) * sizeof(char*));
+    if (!environment)
+    {
+        close(readyPipe[0]);
+        close(readyPipe[1]);
+        return -1.0;
+    }
+    size_t size = 0;
+    for (size_t i = 0; i < count; ++i)
+        if (!gtsps_AssignsVariable(environ[i], variable) && !gtsps_AssignsVariable(environ[i], "GTSPS_READY_FD"))
+            environment[size++] = environ[i];
+    environment[size++] = threadsEntry;
+    environment[size++] = readyEntry;
+    environment[size] = NULL;
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        // execvp() searches the PATH of the caller and passes the new environment
+        environ = environment;
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+    close(readyPipe[1]);
+    free(environment);
+
+    // The read fails if the program exits before the ready mark, the poll expires if
+    // the program hangs
+    double readyTime = -1.0;
+    double deadline = gtsps_ReadClock() + GTSPS_TUNE_TIMEOUT_MS / 1000.0;
+    struct pollfd ready = { readyPipe[0], POLLIN, 0 };
+    int polled = -1;
+    while (pid > 0)
+    {
+        int timeout = (int)((deadline - gtsps_ReadClock()) * 1000.0);
+        polled = poll(&ready, 1, timeout > 0 ? timeout : 0);
+        if (polled >= 0 || errno != EINTR)
+            break;
+    }
+    if (polled == 0)
+        GTSPS_LOG_ERROR("Error: The program didn't report ready in time, killed.\n");
+    if (polled <= 0 || read(readyPipe[0], &readyTime, sizeof(readyTime)) != (ssize_t)sizeof(readyTime))
+        readyTime = -1.0;
+    close(readyPipe[0]);
+
+    if (pid > 0)
+    {
+        kill(pid, SIGKILL);
+        int status = 0;
+        waitpid(pid, &status, 0);
+    }
+    return readyTime;
+}
+
+static int gtsps_CompareDoubles(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+static double gtsps_Median(double* values, int count)
+{
+    qsort(values, (size_t)count, sizeof(double), gtsps_CompareDoubles);
+    return count % 2 ? values[count / 2] : (values[count / 2 - 1] + values[count / 2]) * 0.5;
+}
+
+int StartupTuneThreads(char* const argv[], const char* variable, int minThreads, int maxThreads, int runs,
+                       FILE* out)
+{
+    if (minThreads < 1 || maxThreads < minThreads || runs < 1)
+    {
+        GTSPS_LOG_ERROR("Error: Invalid thread count range or number of runs.\n");
+        return 0;
+    }
+    double* times = (double*)malloc((size_t)runs * sizeof(double));
+    if (!times)
+    {
+        GTSPS_LOG_ERROR("Error: Failed to allocate the tuner.\n");
+        return 0;
+    }
+
+    fprintf(out, "%8s %12s %12s %10s %10s\n", "threads", "median", "mad", "speedup", "gain");
+    int bestThreads = 0;
+    double bestMedian = 0.0, firstMedian = 0.0, previousMedian = 0.0;
+    for (int threads = minThreads; threads <= maxThreads;)
+    {
+        int completed = 0;
+        for (int run = 0; run < runs; ++run)
+        {
+            double readyTime = gtsps_RunUntilReady(argv, variable, threads);
+            if (readyTime >= 0.0)
+                times[completed++] = readyTime;
+        }
+        if (completed == 0)
+        {
+            GTSPS_LOG_ERROR("Error: The program didn't report ready, does it call StartupReady()?\n");
+            bestThreads = 0;
+            break;
+        }
+
+        // The median and the median absolute deviation, robust to the odd slow run
+        double median = gtsps_Median(times, completed);
+        for (int i = 0; i < completed; ++i)
+            times[i] = times[i] > median ? times[i] - median : median - times[i];
+        double deviation = gtsps_Median(times, completed);
+
+        if (firstMedian == 0.0)
+            firstMedian = previousMedian = median;
+        fprintf(out, "%8d %12.6f %12.6f %9.2fx %+9.1f%%%s\n", threads, median, deviation, firstMedian / median,
+                (previousMedian - median) / previousMedian * 100.0,
+                completed < runs ? "  (some runs didn't report ready)" : "");
+        if (bestThreads == 0 || median < bestMedian)
+        {
+            bestThreads = threads;
+            bestMedian = median;
+        }
+        previousMedian = median;
+
+        // 1, 2, 3, 4, 6, 8, 12, 16...: finer steps where the gains are, then the maximum
+        int next = threads < 2 ? threads + 1 : (threads & (threads - 1)) == 0 ? threads * 3 / 2 : threads * 4 / 3;
+        if (threads < maxThreads && next > maxThreads)
+            next = maxThreads;
+        threads = next;
+    }
+
+    free(times);
+
+    if (bestThreads)
+        fprintf(out, "Best: %d threads, %.6f seconds to ready\n", bestThreads, bestMedian);
+    return bestThreads;
+}
+
+#endif // GTSPS_ENABLE_LAUNCHER
+
+///////////////////////////////////////////////////////////////////////////////
+// Fast exit
+#ifdef GTSPS_ENABLE_FAST_EXIT
+
+typedef struct gtsps_FlushHandler
+{
+    StartupFlushHandler handler;
+    void*               userData;
+} gtsps_FlushHandler;
+
+static gtsps_FlushHandler gtsps_flushHandlers[GTSPS_MAX_FLUSH_HANDLERS];
+static GTSPS_ATOMIC(int) gtsps_flushHandlerCount;
+
+void StartupRegisterFlushHandler(StartupFlushHandler handler, void* userData)
+{
+    int index = GTSPS_ATOMIC_FETCH_ADD(&gtsps_flushHandlerCount, 1);
+    if (index >= GTSPS_MAX_FLUSH_HANDLERS)
+    {
+        GTSPS_LOG_ERROR("Error: Too many flush handlers, increase GTSPS_MAX_FLUSH_HANDLERS.\n");
+        return;
+    }
+    gtsps_flushHandlers[index].handler = handler;
+    gtsps_flushHandlers[index].userData = userData;
+}
+
+#ifndef GTSPS_DISABLE_INSTRUMENTATION
+static double gtsps_fastExitTime = -1.0;
+
+static int gtsps_ValidateFastExit()
+{
+    const char* validate = getenv("GTSPS_FAST_EXIT_VALIDATE");
+    return validate && strcmp(validate, "0") != 0;
+}
+#endif
+
+void StartupFastExit(int exitCode)
+{
+    int count = GTSPS_ATOMIC_LOAD(&gtsps_flushHandlerCount);
+    if (count > GTSPS_MAX_FLUSH_HANDLERS)
+        count = GTSPS_MAX_FLUSH_HANDLERS;
+    for (int i = count - 1; i >= 0; --i)
+        gtsps_flushHandlers[i].handler(gtsps_flushHandlers[i].userData);
+    fflush(NULL);
+
+#ifndef GTSPS_DISABLE_INSTRUMENTATION
+    if (gtsps_ValidateFastExit())
+    {
+        // Run the teardown anyway and measure it, the report prints at the very end
+        gtsps_fastExitTime = gtsps_ReadClock();
+        exit(exitCode);
+    }
+#endif
+#if defined(_WIN32)
+    ExitProcess((UINT)exitCode);
+#else
+    _exit(exitCode);
+#endif
+}
+
+// The validation is instrumentation, it doesn't interpose __cxa_atexit() when compiled
+// out
+#ifndef GTSPS_DISABLE_INSTRUMENTATION
+#if defined(__GLIBC__)
+// Static destructors and atexit() handlers are registered through __cxa_atexit(). In
+// validation mode the handlers are wrapped, to time each of them.
+typedef struct gtsps_ExitHandler
+{
+    void  (*function)(void*);
+    void*   argument;
+    double  duration;       //< Negative until it runs
+} gtsps_ExitHandler;
+
+static gtsps_ExitHandler gtsps_exitHandlers[GTSPS_MAX_EXIT_HANDLERS];
+static GTSPS_ATOMIC(int) gtsps_exitHandlerCount;
+
+static void gtsps_TimedExitHandler(void* argument)
+{
+    gtsps_ExitHandler* handler = (gtsps_ExitHandler*)argument;
+    double begin = gtsps_ReadClock();
+    handler->function(handler->argument);
+    handler->duration = gtsps_ReadClock() - begin;
+}
+
+GTSPS_NAMESPACE_END
+
+GTSPS_EXTERN_C int __cxa_atexit(void (*function)(void*), void* argument, void* dso)
+{
+    typedef int (*gtsps_CxaAtExit)(void (*)(void*), void*, void*);
+    static gtsps_CxaAtExit next = NULL;
+    if (!next)
+        next = (gtsps_CxaAtExit)dlsym(RTLD_NEXT, "__cxa_atexit");
+
+    if (GTSPS_QUALIFIED(gtsps_ValidateFastExit)())
+    {
+        int index = GTSPS_ATOMIC_FETCH_ADD(&GTSPS_QUALIFIED(gtsps_exitHandlerCount), 1);
+        if (index < GTSPS_MAX_EXIT_HANDLERS)
+        {
+            GTSPS_QUALIFIED(gtsps_ExitHandler)* handler = &GTSPS_QUALIFIED(gtsps_exitHandlers)[index];
+            handler->function = function;
+            handler->argument = argument;
+            handler->duration = -1.0;
+            return next(GTSPS_QUALIFIED(gtsps_TimedExitHandler), handler, dso);
+        }
+    }
+    return next(function, argument, dso);
+}
+
+GTSPS_NAMESPACE_BEGIN
+#endif // __GLIBC__
+
+#if defined(__GLIBC__)
+typedef struct gtsps_CodeModule
+{
+    uintptr_t   address;
+    const char* path;
+    uintptr_t   loadBase;
+    uint8_t     buildId[20];
+    uint32_t    buildIdSize;
+    char        executable[4096];
+} gtsps_CodeModule;
+
+static int gtsps_FindCodeModule(gtsps_ModuleInfo* info, size_t infoSize, void* userData)
+{
+    (void)infoSize;
+    gtsps_CodeModule* module = (gtsps_CodeModule*)userData;
+    for (int i = 0; i < info->dlpi_phnum; ++i)
+    {
+        const ElfW(Phdr)* segment = &info->dlpi_phdr[i];
+        uintptr_t begin = (uintptr_t)(info->dlpi_addr + segment->p_vaddr);
+        if (segment->p_type != PT_LOAD || module->address < begin || module->address - begin >= segment->p_memsz)
+            continue;
+
+        module->path = info->dlpi_name;
+        if (!module->path || !module->path[0])
+        {
+            // The main program has no name, resolve it
+            ssize_t length = readlink("/proc/self/exe", module->executable, sizeof(module->executable) - 1);
+            module->executable[length > 0 ? length : 0] = '\0';
+            module->path = module->executable;
+        }
+        module->loadBase = (uintptr_t)info->dlpi_addr;
+        module->buildIdSize = gtsps_ModuleBuildId(info, module->buildId, sizeof(module->buildId));
+        return 1;
+    }
+    return 0;
+}
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+// Destructors run after the handlers registered with __cxa_atexit() since the start
+// of the program, the lowest priority runs last.
+__attribute__((destructor(101)))
+static void gtsps_ReportFastExitValidation()
+{
+    if (gtsps_fastExitTime < 0.0)
+        return;
+
+    double teardown = gtsps_ReadClock() - gtsps_fastExitTime;
+    fprintf(stderr, "Fast exit validation: the teardown took %.6f seconds\n", teardown);
+
+#if defined(__GLIBC__)
+    int count = GTSPS_ATOMIC_LOAD(&gtsps_exitHandlerCount);
+    if (count > GTSPS_MAX_EXIT_HANDLERS)
+    {
+        fprintf(stderr, "  %d handlers not timed, increase GTSPS_MAX_EXIT_HANDLERS\n",
+                count - GTSPS_MAX_EXIT_HANDLERS);
+        count = GTSPS_MAX_EXIT_HANDLERS;
+    }
+    for (int i = count - 1; i >= 0; --i)
+    {
+        const gtsps_ExitHandler* handler = &gtsps_exitHandlers[i];
+        if (handler->duration < 0.0)
+            continue;
+
+        // Raw addresses, as addr2line takes them: symbols are not worth loading here
+        gtsps_CodeModule module;
+        memset(&module, 0, sizeof(module));
+        module.address = (uintptr_t)(void*)handler->function;
+        if (!dl_iterate_phdr(gtsps_FindCodeModule, &module))
+        {
+            fprintf(stderr, "  %10.6f  0x%llx\n", handler->duration, (unsigned long long)module.address);
+            continue;
+        }
+
+        char buildId[2 * sizeof(module.buildId) + 1] = "none";
+        for (uint32_t j = 0; j < module.buildIdSize; ++j)
+            snprintf(buildId + 2 * j, 3, "%02x", module.buildId[j]);
+        fprintf(stderr, "  %10.6f  %s 0x%llx (build-id %s)\n", handler->duration, module.path,
+                (unsigned long long)(module.address - module.loadBase), buildId);
+    }
+#endif
+}
+#endif
+#endif // GTSPS_DISABLE_INSTRUMENTATION
+
+#endif // GTSPS_ENABLE_FAST_EXIT
+
+///////////////////////////////////////////////////////////////////////////////
+// Huge page text
+#ifdef GTSPS_ENABLE_HUGE_TEXT
+
+size_t StartupRemapTextToHugePages()
+{
+#if defined(linux) || defined(__linux__) || defined(__LINUX__)
+    const uintptr_t hugePageSize = 2 * 1024 * 1024;
+    int span = StartupSpanBegin("huge page text remap");
+
+    // Find the executable mapping of the main program
+    char executable[4096];
+    ssize_t executableLength = readlink("/proc/self/exe", executable, sizeof(executable) - 1);
+    uintptr_t textBegin = 0, textEnd = 0;
+    FILE* maps = executableLength > 0 ? fopen("/proc/self/maps", "r") : NULL;
+    if (maps)
+    {
+        executable[executableLength] = '\0';
+
+        char line[4096 + 128];
+        while (fgets(line, sizeof(line), maps))
+        {
+            unsigned long begin, end;
+            char permissions[8];
+            int pathOffset = 0;
+            if (sscanf(line, "%lx-%lx %7s %*s %*s %*s %n", &begin, &end, permissions, &pathOffset) < 3 ||
+                pathOffset == 0)
+                continue;
+
+            char* path = line + pathOffset;
+            path[strcspn(path, "\n")] = '\0';
+            if (strcmp(permissions, "r-xp") == 0 && strcmp(path, executable) == 0)
+            {
+                textBegin = (uintptr_t)begin;
+                textEnd = (uintptr_t)end;
+                break;
+            }
+        }
+        fclose(maps);
+    }
+    if (textEnd == 0)
+    {
+        GTSPS_LOG_ERROR("Error: Failed to find the text segment in /proc/self/maps.\n");
+        StartupSpanEnd(span);
+        return 0;
+    }
+
+    // Only whole huge pages can be remapped
+    uintptr_t begin = (textBegin + hugePageSize - 1) & ~(hugePageSize - 1);
+    uintptr_t end = textEnd & ~(hugePageSize - 1);
+    if (end <= begin)
+    {
+        StartupSpanEnd(span);
+        return 0;
+    }
+    size_t size = end - begin;
+
+    // Reserve an aligned region, populate it with huge pages and the copy of the code
+    char* reserved = (char*)mmap(NULL, size + hugePageSize, PROT_READ | PROT_WRITE,
+                                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (reserved == MAP_FAILED)
+    {
+        GTSPS_LOG_ERROR("Error: Failed to allocate the huge page text region.\n");
+        StartupSpanEnd(span);
+        return 0;
+    }
+    char* aligned = (char*)(((uintptr_t)reserved + hugePageSize - 1) & ~(hugePageSize - 1));
+    if (aligned > reserved)
+        munmap(reserved, (size_t)(aligned - reserved));
+    munmap(aligned + size, (size_t)(reserved + hugePageSize - aligned));
+
+    madvise(aligned, size, MADV_HUGEPAGE);
+    memcpy(aligned, (const void*)begin, size);
+    if (mprotect(aligned, size, PROT_READ | PROT_EXEC) != 0)
+    {
+        GTSPS_LOG_ERROR("Error: Failed to protect the huge page text region.\n");
+        munmap(aligned, size);
+        StartupSpanEnd(span);
+        return 0;
+    }
+
+    // Replace the original text with a single system call,  the code executing this
+    // function may live in the remapped range, and the copy is identical.
+    if ((void*)syscall(SYS_mremap, aligned, size, size, MREMAP_MAYMOVE | MREMAP_FIXED, (void*)begin) == MAP_FAILED)
+    {
+        GTSPS_LOG_ERROR("Error: Failed to remap the text to huge pages.\n");
+        munmap(aligned, size);
+        StartupSpanEnd(span);
+        return 0;
+    }
+
+    StartupSpanEnd(span);
+    return size;
+#else
+    return 0;
+#endif
+}
+
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(GTSPS_DISABLE_INSTRUMENTATION)
+__attribute__((constructor(101)))
+static void gtsps_RemapTextToHugePagesAtStartup()
+{
+    const char* enabled = getenv("GTSPS_HUGE_TEXT");
+    if (!enabled || strcmp(enabled, "0") != 0)
+        StartupRemapTextToHugePages();
+}
+#endif
+
+#endif // GTSPS_ENABLE_HUGE_TEXT
+
+///////////////////////////////////////////////////////////////////////////////
+// Init-only memory
+#ifdef GTSPS_ENABLE_INIT_MEMORY
+#if defined(linux) || defined(__linux__) || defined(__LINUX__)
+
+GTSPS_NAMESPACE_END
+// Defined by the linker when the sections exist in the module, weak otherwise
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern char __start_gtsps_init_text[] __attribute__((weak, visibility("hidden")));
+extern char __stop_gtsps_init_text[] __attribute__((weak, visibility("hidden")));
+extern char __start_gtsps_init_data[] __attribute__((weak, visibility("hidden")));
+extern char __stop_gtsps_init_data[] __attribute__((weak, visibility("hidden")));
+extern char __start_gtsps_init_bss[] __attribute__((weak, visibility("hidden")));
+extern char __stop_gtsps_init_bss[] __attribute__((weak, visibility("hidden")));
+#ifdef __cplusplus
+}
+#endif
+GTSPS_NAMESPACE_BEGIN
+
+#define GTSPS_INIT_ARENA_EMPTY    0
+#define GTSPS_INIT_ARENA_MAPPING  1
+#define GTSPS_INIT_ARENA_READY    2
+#define GTSPS_INIT_ARENA_RELEASED 3
+
+typedef struct gtsps_InitRegion
+{
+    void*  address;
+    size_t size;
+} gtsps_InitRegion;
+
+static GTSPS_ATOMIC(int) gtsps_initArenaState;
+static char* gtsps_initArena;
+static GTSPS_ATOMIC(size_t) gtsps_initArenaUsed;
+static gtsps_InitRegion gtsps_initRegions[GTSPS_MAX_INIT_REGIONS];
+static GTSPS_ATOMIC(int) gtsps_initRegionCount;
+static GTSPS_ATOMIC(int) gtsps_initMemoryReleased;
+
+void* StartupInitAlloc(size_t size)
+{
+    // The arena is reserved at the first allocation, pages are committed on first touch
+    int state = GTSPS_ATOMIC_LOAD(&gtsps_initArenaState);
+    int expected = GTSPS_INIT_ARENA_EMPTY;
+    if (state == GTSPS_INIT_ARENA_EMPTY &&
+        GTSPS_ATOMIC_CAS(&gtsps_initArenaState, &expected, GTSPS_INIT_ARENA_MAPPING))
+    {
+        void* arena = mmap(NULL, GTSPS_INIT_ARENA_SIZE, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        gtsps_initArena = arena != MAP_FAILED ? (char*)arena : NULL;
+        GTSPS_ATOMIC_STORE(&gtsps_initArenaState, GTSPS_INIT_ARENA_READY);
+    }
+    while ((state = GTSPS_ATOMIC_LOAD(&gtsps_initArenaState)) == GTSPS_INIT_ARENA_MAPPING)
+        sched_yield();
+
+    if (state == GTSPS_INIT_ARENA_RELEASED || !gtsps_initArena)
+    {
+        GTSPS_LOG_ERROR("Error: The init arena is released or failed to map.\n");
+        return NULL;
+    }
+
+    size_t alignedSize = (size + 15) & ~(size_t)15;
+    size_t offset = GTSPS_ATOMIC_FETCH_ADD(&gtsps_initArenaUsed, alignedSize);
+    if (alignedSize < size || offset > GTSPS_INIT_ARENA_SIZE || GTSPS_INIT_ARENA_SIZE - offset < alignedSize)
+    {
+        GTSPS_LOG_ERROR("Error: The init arena is full, increase GTSPS_INIT_ARENA_SIZE.\n");
+        return NULL;
+    }
+    return gtsps_initArena + offset;
+}
+
+void StartupTagInitOnly(void* address, size_t size)
+{
+    int index = GTSPS_ATOMIC_FETCH_ADD(&gtsps_initRegionCount, 1);
+    if (index >= GTSPS_MAX_INIT_REGIONS)
+    {
+        GTSPS_LOG_ERROR("Error: Too many init-only regions, increase GTSPS_MAX_INIT_REGIONS.\n");
+        return;
+    }
+    gtsps_initRegions[index].address = address;
+    gtsps_initRegions[index].size = size;
+}
+
+// @brief  Releases the pages fully inside [begin, end).
+//
+// @return the bytes released.
+static size_t gtsps_ReleasePages(const char* begin, const char* end)
+{
+    uintptr_t pageSize = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t first = ((uintptr_t)begin + pageSize - 1) & ~(pageSize - 1);
+    uintptr_t last = (uintptr_t)end & ~(pageSize - 1);
+    if (!begin || last <= first || madvise((void*)first, last - first, MADV_DONTNEED) != 0)
+        return 0;
+    return last - first;
+}
+
+static size_t gtsps_ResidentSize()
+{
+    size_t resident = 0;
+    int fd = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+    if (fd >= 0)
+    {
+        char buffer[128];
+        ssize_t size = read(fd, buffer, sizeof(buffer) - 1);
+        close(fd);
+        unsigned long pages = 0;
+        if (size > 0)
+        {
+            buffer[size] = '\0';
+            if (sscanf(buffer, "%*u %lu", &pages) == 1)
+                resident = (size_t)pages * (size_t)sysconf(_SC_PAGESIZE);
+        }
+    }
+    return resident;
+}
+
+size_t StartupReleaseInitMemory()
+{
+    if (GTSPS_ATOMIC_FETCH_ADD(&gtsps_initMemoryReleased, 1) != 0)
+        return 0;
+
+    int span = StartupSpanBegin("release init memory");
+    size_t residentBefore = gtsps_ResidentSize();
+
+    // Allocations fail from now on, the memory allocated must be out of use
+    int state = GTSPS_ATOMIC_LOAD(&gtsps_initArenaState);
+    while (state == GTSPS_INIT_ARENA_MAPPING ||
+           !GTSPS_ATOMIC_CAS(&gtsps_initArenaState, &state, GTSPS_INIT_ARENA_RELEASED))
+    {
+        sched_yield();
+        state = GTSPS_ATOMIC_LOAD(&gtsps_initArenaState);
+    }
+    size_t arenaSize = GTSPS_ATOMIC_LOAD(&gtsps_initArenaUsed);
+    if (gtsps_initArena)
+        munmap(gtsps_initArena, GTSPS_INIT_ARENA_SIZE);
+    gtsps_initArena = NULL;
+
+    size_t released = 0;
+    int regionCount = GTSPS_ATOMIC_LOAD(&gtsps_initRegionCount);
+    if (regionCount > GTSPS_MAX_INIT_REGIONS)
+        regionCount = GTSPS_MAX_INIT_REGIONS;
+    for (int i = 0; i < regionCount; ++i)
+    {
+        const char* begin = (const char*)gtsps_initRegions[i].address;
+        released += gtsps_ReleasePages(begin, begin + gtsps_initRegions[i].size);
+    }
+    size_t sections = gtsps_ReleasePages(__start_gtsps_init_text, __stop_gtsps_init_text) +
+                      gtsps_ReleasePages(__start_gtsps_init_data, __stop_gtsps_init_data) +
+                      gtsps_ReleasePages(__start_gtsps_init_bss, __stop_gtsps_init_bss);
+
+    size_t residentAfter = gtsps_ResidentSize();
+    size_t reclaimed = residentBefore > residentAfter ? residentBefore - residentAfter : 0;
+    StartupSpanEnd(span);
+
+    const char* report = getenv("GTSPS_INIT_MEMORY_REPORT");
+    if (report && strcmp(report, "0") != 0)
+    {
+        fprintf(stderr, "Init memory: %.1f MB of resident memory reclaimed (arena %.1f MB, %d regions %.1f MB, "
+                "sections %.1f MB)\n", reclaimed / 1048576.0, arenaSize / 1048576.0, regionCount,
+                released / 1048576.0, sections / 1048576.0);
+    }
+    return reclaimed;
+}
+
+#undef GTSPS_INIT_ARENA_EMPTY
+#undef GTSPS_INIT_ARENA_MAPPING
+#undef GTSPS_INIT_ARENA_READY
+#undef GTSPS_INIT_ARENA_RELEASED
+
+#else
+void* StartupInitAlloc(size_t size)
+{
+    (void)size;
+    return NULL;
+}
+
+void StartupTagInitOnly(void* address, size_t size)
+{
+    (void)address;
+    (void)size;
+}
+
+size_t StartupReleaseInitMemory()
+{
+    return 0;
+}
+#endif
+#endif // GTSPS_ENABLE_INIT_MEMORY
+
+///////////////////////////////////////////////////////////////////////////////
+// Offline tools
+#if defined(GTSPS_ENABLE_OFFLINE_TOOLS) && !defined(GTSPS_DISABLE_INSTRUMENTATION) && \
+    (defined(linux) || defined(__linux__) || defined(__LINUX__))
+
+typedef struct gtsps_OfflineModule
+{
+    const char*                path;
+    const StartupModuleRecord* record;
+    char                       file[4096];  //< The ELF file to resolve from, empty if not found yet
+    int                        searched;
+} gtsps_OfflineModule;
+
+// @brief  Reads the build-id of an ELF file of the same class of the process.
+//
+// @return the size of the build-id, 0 if the file has none or can't be read.
+static uint32_t gtsps_FileBuildId(const char* path, uint8_t* buildId, uint32_t capacity)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return 0;
+
+    struct stat info;
+    void* mapping = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(ElfW(Ehdr)))
+        mapping = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return 0;
+
+    const char* data = (const char*)mapping;
+    size_t size = (size_t)info.st_size;
+    ElfW(Ehdr) header;
+    memcpy(&header, data, sizeof(header));
+
+    uint32_t buildIdSize = 0;
+    if (memcmp(header.e_ident, ELFMAG, SELFMAG) == 0 &&
+        header.e_ident[EI_CLASS] == (sizeof(void*) == 8 ? ELFCLASS64 : ELFCLASS32) &&
+        header.e_phentsize == sizeof(ElfW(Phdr)) && header.e_phoff <= size &&
+        (size - header.e_phoff) / sizeof(ElfW(Phdr)) >= header.e_phnum)
+    {
+        for (int i = 0; i < header.e_phnum && buildIdSize == 0; ++i)
+        {
+            ElfW(Phdr) segment;
+            memcpy(&segment, data + header.e_phoff + i * sizeof(ElfW(Phdr)), sizeof(segment));
+            if (segment.p_type == PT_NOTE && segment.p_offset <= size && size - segment.p_offset >= segment.p_filesz)
+                buildIdSize = gtsps_FindBuildIdNote(data + segment.p_offset, data + segment.p_offset + segment.p_filesz,
+                                                    buildId, capacity);
+        }
+    }
+    munmap(mapping, size);
+    return buildIdSize;
+}
+
+// @brief  Finds the ELF file matching a module: the separate debug info by build-id,
+//         or the module itself if it didn't change since the records were written.
+static void gtsps_FindModuleFile(gtsps_OfflineModule* module, const char* debugDirectory)
+{
+    module->searched = 1;
+    const StartupModuleRecord* record = module->record;
+    if (record->buildIdSize == 0)
+    {
+        snprintf(module->file, sizeof(module->file), "%s", module->path);
+        return;
+    }
+
+    char hex[2 * sizeof(record->buildId) + 1];
+    for (uint32_t i = 0; i < record->buildIdSize; ++i)
+        snprintf(hex + 2 * i, 3, "%02x", record->buildId[i]);
+    snprintf(module->file, sizeof(module->file), "%s/.build-id/%.2s/%s.debug", debugDirectory, hex, hex + 2);
+    if (access(module->file, R_OK) == 0)
+        return;
+
+    uint8_t buildId[sizeof(record->buildId)];
+    if (gtsps_FileBuildId(module->path, buildId, sizeof(buildId)) == record->buildIdSize &&
+        memcmp(buildId, record->buildId, record->buildIdSize) == 0)
+        snprintf(module->file, sizeof(module->file), "%s", module->path);
+    else
+        module->file[0] = '\0';
+}
+
+// @brief  Resolves an address with addr2line, the result is "function at file:line",
+//         or "module+0xoffset" if the file or the symbol can't be found.
+static void gtsps_Symbolize(gtsps_OfflineModule* modules, int moduleCount, uint64_t address,
+                            const char* debugDirectory, char* symbol, size_t symbolSize)
+{
+    // The module loaded at the highest base below the address
+    gtsps_OfflineModule* module = NULL;
+    for (int i = 0; i < moduleCount; ++i)
+    {
+        if (modules[i].record->loadBase <= address && (!module || modules[i].record->loadBase > module->record->loadBase))
+            module = &modules[i];
+    }
+    if (!module)
+    {
+        snprintf(symbol, symbolSize, "0x%llx", (unsigned long long)address);
+        return;
+    }
+
+    uint64_t offset = address - module->record->loadBase;
+    snprintf(symbol, symbolSize, "%s+0x%llx", module->path, (unsigned long long)offset);
+    if (!module->searched)
+        gtsps_FindModuleFile(module, debugDirectory);
+    if (!module->file[0] || strchr(module->file, '\''))
+        return;
+
+    char command[4096 + 64];
+    snprintf(command, sizeof(command), "addr2line -f -C -e '%s' 0x%llx 2>/dev/null", module->file,
+             (unsigned long long)offset);
+    FILE* pipe = popen(command, "r");
+    if (!pipe)
+        return;
+
+    char function[1024], location[1024];
+    if (fgets(function, sizeof(function), pipe) && fgets(location, sizeof(location), pipe))
+    {
+        function[strcspn(function, "\n")] = '\0';
+        location[strcspn(location, "\n")] = '\0';
+        if (strcmp(function, "??") != 0)
+            snprintf(symbol, symbolSize, "%s at %s", function, location);
+    }
+    pclose(pipe);
+}
+
+int PrintSymbolizedStartupRecords(const char* recordsPath, const char* debugDirectory, FILE* out)
+{
+    StartupRecordReader reader;
+    if (!OpenStartupRecords(recordsPath, &reader))
+        return 0;
+    if (!debugDirectory)
+        debugDirectory = "/usr/lib/debug";
+
+    gtsps_OfflineModule* modules = NULL;
+    int moduleCount = 0, moduleCapacity = 0;
+    int* parents = NULL;
+    int eventCount = 0, eventCapacity = 0;
+    int failed = 0;
+
+    StartupRecord record;
+    while (!failed && NextStartupRecord(&reader, &record))
+    {
+        if (record.type == GTSPS_RECORD_PROCESS)
+        {
+            const StartupProcessRecord* process = (const StartupProcessRecord*)record.data;
+            fprintf(out, "Process %d\n%10s %10s %10s  %s\n", process->pid, "begin", "end", "duration", "name");
+            moduleCount = 0;
+            eventCount = 0;
+        }
+        else if (record.type == GTSPS_RECORD_MODULE)
+        {
+            if (moduleCount == moduleCapacity)
+            {
+                moduleCapacity = moduleCapacity ? moduleCapacity * 2 : 64;
+                gtsps_OfflineModule* grown = (gtsps_OfflineModule*)realloc(modules, (size_t)moduleCapacity * sizeof(*modules));
+                if (!grown)
+                {
+                    failed = 1;
+                    break;
+                }
+                modules = grown;
+            }
+            gtsps_OfflineModule* module = &modules[moduleCount++];
+            module->path = record.name;
+            module->record = (const StartupModuleRecord*)record.data;
+            module->file[0] = '\0';
+            module->searched = 0;
+        }
+        else if (record.type == GTSPS_RECORD_MARK || record.type == GTSPS_RECORD_SPAN)
+        {
+            const StartupEventRecord* event = (const StartupEventRecord*)record.data;
+            if (eventCount == eventCapacity)
+            {
+                eventCapacity = eventCapacity ? eventCapacity * 2 : 1024;
+                int* grown = (int*)realloc(parents, (size_t)eventCapacity * sizeof(int));
+                if (!grown)
+                {
+                    failed = 1;
+                    break;
+                }
+                parents = grown;
+            }
+            parents[eventCount++] = event->parent;
+
+            int depth = 0;
+            for (int parent = event->parent; parent >= 0 && parent < eventCount - 1 && depth < eventCount;
+                 parent = parents[parent])
+                ++depth;
+
+            // Names like "0x7f3a2c01d2e0" are code addresses
+            char symbol[4096 + 1024];
+            const char* name = record.name;
+            char* end = NULL;
+            unsigned long long address = strncmp(name, "0x", 2) == 0 ? strtoull(name + 2, &end, 16) : 0;
+            if (end && end != name + 2 && *end == '\0')
+            {
+                gtsps_Symbolize(modules, moduleCount, (uint64_t)address, debugDirectory, symbol, sizeof(symbol));
+                name = symbol;
+            }
+
+            if (record.type == GTSPS_RECORD_MARK)
+                fprintf(out, "%10.6f %10s %10s  %*s%s\n", event->begin, "", "", depth * 2, "", name);
+            else if (event->end < 0.0)
+                fprintf(out, "%10.6f %10s %10s  %*s%s\n", event->begin, "open", "", depth * 2, "", name);
+            else
+                fprintf(out, "%10.6f %10.6f %10.6f  %*s%s\n", event->begin, event->end, event->end - event->begin,
+                        depth * 2, "", name);
+        }
+    }
+
+    if (failed)
+        GTSPS_LOG_ERROR("Error: Failed to allocate the symbolization state.\n");
+    free(modules);
+    free(parents);
+    CloseStartupRecords(&reader);
+    return !failed;
+}
+
+#endif // GTSPS_ENABLE_OFFLINE_TOOLS
+
+GTSPS_NAMESPACE_END
+#undef GTSPS_LOG_ERROR
+
+#endif // GTSPS_IMPLEMENTATION
+
+#undef GTSPS_NAMESPACE_BEGIN
+#undef GTSPS_NAMESPACE_END
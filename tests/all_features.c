@@ -0,0 +1,71 @@
+/* Copyright 2024 Max Liani
+   SPDX-License-Identifier: MIT
+
+   Builds the header as C11 with every feature enabled and runs the timeline through
+   its text and binary files. The system headers come first, the implementation
+   doesn't depend on _GNU_SOURCE.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#define GTSPS_ENABLE_PERF_COUNTERS
+#define GTSPS_ENABLE_OFFLINE_TOOLS
+#define GTSPS_ENABLE_LIVE_RING
+#define GTSPS_ENABLE_INIT_MEMORY
+#define GTSPS_ENABLE_FAST_EXIT
+#define GTSPS_ENABLE_ASYNC_IO
+#define GTSPS_ENABLE_ZYGOTE
+#define GTSPS_ENABLE_LAUNCHER
+#define GTSPS_ENABLE_HUGE_TEXT
+#define GTSPS_IMPLEMENTATION
+#include "GetTimeSinceProcessStart.h"
+
+// The hook resolves puts() of the C library without <dlfcn.h>
+GTSPS_HOOK_FUNCTION(int, puts, (const char* text), (text))
+
+#define CHECK(condition) \
+    do { if (!(condition)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); return 1; } } while (0)
+
+static int FindEvent(const StartupEvent* events, int count, const char* name)
+{
+    for (int i = 0; i < count; ++i)
+        if (strcmp(events[i].name, name) == 0)
+            return i;
+    return -1;
+}
+
+int main(void)
+{
+    CHECK(GetTimeSinceProcessStart() > 0.0);
+
+    int load = StartupSpanBegin("load");
+    int parse = StartupSpanBegin("parse");
+    StartupSpanEnd(parse);
+    StartupSpanEnd(load);
+    CHECK(puts("hooked") >= 0);
+    StartupReady();
+
+    // The features add their own events, e.g. the huge page remap of the text
+    StartupEvent events[16];
+    int count = GetStartupTimeline(events, 16);
+    int parseIndex = FindEvent(events, count, "parse");
+    CHECK(parseIndex > 0 && events[parseIndex].end >= events[parseIndex].begin);
+    CHECK(events[parseIndex].parent == FindEvent(events, count, "load"));
+    CHECK(FindEvent(events, count, "puts") > parseIndex);
+
+    StartupTimeline timeline;
+    CHECK(SaveStartupTimeline("all_features_c.txt"));
+    CHECK(LoadStartupTimeline("all_features_c.txt", &timeline));
+    CHECK(timeline.count == count);
+    FreeStartupTimeline(&timeline);
+
+    remove("all_features_c.bin");
+    CHECK(AppendStartupRecords("all_features_c.bin"));
+    CHECK(LoadStartupTimeline("all_features_c.bin", &timeline));
+    CHECK(timeline.count == count && timeline.events[parseIndex].parent == parseIndex - 1);
+    FreeStartupTimeline(&timeline);
+
+    CHECK(SaveStartupProfile("all_features_c.pb"));
+    return 0;
+}
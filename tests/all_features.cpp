@@ -0,0 +1,42 @@
+/* Copyright 2024 Max Liani
+   SPDX-License-Identifier: MIT
+
+   Builds the header as C++ inside a namespace with every feature enabled.
+*/
+
+#define GTSPS_NAMESPACE Gtsps
+#define GTSPS_ENABLE_PERF_COUNTERS
+#define GTSPS_ENABLE_OFFLINE_TOOLS
+#define GTSPS_ENABLE_LIVE_RING
+#define GTSPS_ENABLE_INIT_MEMORY
+#define GTSPS_ENABLE_FAST_EXIT
+#define GTSPS_ENABLE_ASYNC_IO
+#define GTSPS_ENABLE_ZYGOTE
+#define GTSPS_ENABLE_LAUNCHER
+#define GTSPS_ENABLE_HUGE_TEXT
+#define GTSPS_IMPLEMENTATION
+#include "GetTimeSinceProcessStart.h"
+#include <string.h>
+
+static void LoadConfig()
+{
+    Gtsps::StartupMark("config parsed");
+}
+
+int main()
+{
+    if (Gtsps::GetTimeSinceProcessStart() <= 0.0)
+        return 1;
+
+    int span = Gtsps::StartupSpanBeginAt((const void*)&LoadConfig);
+    LoadConfig();
+    Gtsps::StartupSpanEnd(span);
+    Gtsps::StartupReady();
+
+    Gtsps::StartupEvent events[16];
+    int count = Gtsps::GetStartupTimeline(events, 16);
+    for (int i = 0; i < count; ++i)
+        if (strcmp(events[i].name, "config parsed") == 0)
+            return events[i].parent >= 0 && strncmp(events[events[i].parent].name, "0x", 2) == 0 ? 0 : 1;
+    return 1;
+}
@@ -0,0 +1,91 @@
+/* Copyright 2024 Max Liani
+   SPDX-License-Identifier: MIT
+
+   Loads a batch of files larger than the depth of the ring and the number of workers,
+   waiting for them from two threads, and checks their content and their spans.
+*/
+
+#define GTSPS_ENABLE_ASYNC_IO
+#define GTSPS_IMPLEMENTATION
+#include "GetTimeSinceProcessStart.h"
+#include <pthread.h>
+#include <string.h>
+
+#define CHECK(condition) \
+    do { if (!(condition)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); return 1; } } while (0)
+
+#define FILE_COUNT 100
+
+static char paths[FILE_COUNT][64];
+static StartupFileBatch* batch;
+
+// Files of increasing size, the first one is empty and the content is a function of
+// the index and the offset
+static size_t FileSize(int index)
+{
+    return (size_t)index * 997;
+}
+
+static char FileByte(int index, size_t offset)
+{
+    return (char)('a' + (index + offset) % 26);
+}
+
+static int CheckFile(int index)
+{
+    size_t size = 1;
+    const char* data = (const char*)StartupWaitForFile(batch, index, &size);
+    CHECK(data && size == FileSize(index) && data[size] == '\0');
+    for (size_t offset = 0; offset < size; ++offset)
+        CHECK(data[offset] == FileByte(index, offset));
+    return 0;
+}
+
+// Waits for the files from the end, while the main thread waits from the start
+static void* WaitBackwards(void* arg)
+{
+    (void)arg;
+    for (int i = FILE_COUNT - 1; i >= 0; --i)
+        if (CheckFile(i) != 0)
+            return (void*)1;
+    return NULL;
+}
+
+int main(void)
+{
+    const char* names[FILE_COUNT + 1];
+    for (int i = 0; i < FILE_COUNT; ++i)
+    {
+        snprintf(paths[i], sizeof(paths[i]), "async_io_%d.txt", i);
+        FILE* file = fopen(paths[i], "wb");
+        CHECK(file);
+        for (size_t offset = 0; offset < FileSize(i); ++offset)
+            fputc(FileByte(i, offset), file);
+        fclose(file);
+        names[i] = paths[i];
+    }
+    names[FILE_COUNT] = "async_io_missing.txt";
+
+    batch = StartupLoadFilesAsync(names, FILE_COUNT + 1);
+    CHECK(batch);
+    pthread_t thread;
+    CHECK(pthread_create(&thread, NULL, WaitBackwards, NULL) == 0);
+    for (int i = 0; i < FILE_COUNT; ++i)
+        CHECK(CheckFile(i) == 0);
+    void* result = (void*)1;
+    CHECK(pthread_join(thread, &result) == 0 && result == NULL);
+    CHECK(StartupWaitForFile(batch, FILE_COUNT, NULL) == NULL);
+    StartupFreeFiles(batch);
+
+    // One span per file, including the one that failed to load
+    StartupEvent events[FILE_COUNT + 8];
+    int count = GetStartupTimeline(events, FILE_COUNT + 8);
+    int spans = 0;
+    for (int i = 0; i < count; ++i)
+        spans += strncmp(events[i].name, "async_io_", 9) == 0 && events[i].end >= events[i].begin;
+    CHECK(spans == FILE_COUNT + 1);
+
+    for (int i = 0; i < FILE_COUNT; ++i)
+        remove(paths[i]);
+    return 0;
+}
@@ -0,0 +1,83 @@
+# Checks a build with GTSPS_DISABLE_INSTRUMENTATION against an empty program:
+#   cmake -DNM=<nm> -DREADELF=<readelf> -DPROGRAM=<program> -DEMPTY=<empty program>
+#         -P check_disabled_release.cmake
+# The program defines no symbol more than the empty program, other than the ones of
+# GetTimeSinceProcessStart() and of the release of the init-only memory, and
+# .init_array has the same size.
+cmake_minimum_required(VERSION 3.14)
+
+set(ALLOWED_SYMBOLS
+    GetTimeSinceProcessStart
+    gtsps_processAnchor
+    gtsps_ReadProcessStartTime
+    gtsps_ProcessStartTime
+    gtsps_ReadClock
+    gtsps_EmptyAnchorInChild
+    # StartupReady() still releases the init-only memory of GTSPS_ENABLE_INIT_MEMORY
+    StartupReady
+    StartupReleaseInitMemory
+    gtsps_ReleasePages
+    gtsps_ResidentSize
+    gtsps_initArena
+    gtsps_initArenaState
+    gtsps_initArenaUsed
+    gtsps_initMemoryReleased
+    gtsps_initRegionCount
+    gtsps_initRegions
+    # The C library symbols they pull in: pthread_atfork() and the stream of the errors
+    pthread_atfork
+    __pthread_atfork
+    stderr)
+
+# @brief  Lists the names of the symbols a program defines, from lines of nm like
+#         "<address> <type> <name>".
+function(defined_symbols program output)
+    execute_process(COMMAND ${NM} --defined-only ${program} OUTPUT_VARIABLE symbols RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${NM} failed on ${program}")
+    endif()
+    string(REPLACE "\n" ";" lines "${symbols}")
+    set(names "")
+    foreach(line IN LISTS lines)
+        if(line MATCHES "[ \t]([^ \t]+)$")
+            list(APPEND names ${CMAKE_MATCH_1})
+        endif()
+    endforeach()
+    set(${output} ${names} PARENT_SCOPE)
+endfunction()
+
+# Any symbol the empty program doesn't have comes from the library, e.g. a hook
+defined_symbols(${PROGRAM} programSymbols)
+defined_symbols(${EMPTY} emptySymbols)
+set(unexpected "")
+foreach(symbol IN LISTS programSymbols)
+    # Static functions get a suffix when the compiler clones them, e.g. .constprop.0,
+    # and copies of library variables their version, e.g. @GLIBC_2.2.5
+    string(REGEX REPLACE "[.@].*$" "" name "${symbol}")
+    if(NOT symbol IN_LIST emptySymbols AND NOT name IN_LIST ALLOWED_SYMBOLS)
+        list(APPEND unexpected ${symbol})
+    endif()
+endforeach()
+if(unexpected)
+    message(FATAL_ERROR "Symbols left by the disabled instrumentation: ${unexpected}")
+endif()
+
+function(init_array_size program output)
+    execute_process(COMMAND ${READELF} -SW ${program} OUTPUT_VARIABLE sections RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${READELF} failed on ${program}")
+    endif()
+    # [Nr] Name Type Address Off Size ...
+    if(sections MATCHES "\\.init_array[ \t]+[A-Z_]+[ \t]+[0-9a-f]+[ \t]+[0-9a-f]+[ \t]+([0-9a-f]+)")
+        set(${output} ${CMAKE_MATCH_1} PARENT_SCOPE)
+    else()
+        set(${output} 0 PARENT_SCOPE)
+    endif()
+endfunction()
+
+init_array_size(${PROGRAM} programSize)
+init_array_size(${EMPTY} emptySize)
+if(NOT programSize STREQUAL emptySize)
+    message(FATAL_ERROR ".init_array of ${programSize} bytes, ${emptySize} in the empty program")
+endif()
+message(STATUS "No instrumentation symbol left, .init_array of ${programSize} bytes as the empty program")
@@ -0,0 +1,50 @@
+/* Copyright 2024 Max Liani
+   SPDX-License-Identifier: MIT
+
+   Records marks from several threads while the main thread copies the timeline, and
+   checks that the copies only hold events completely written: a reader never sees
+   an event claimed by another thread before it is published.
+*/
+
+#define GTSPS_TIMELINE_CAPACITY 65536
+#define GTSPS_IMPLEMENTATION
+#include "GetTimeSinceProcessStart.h"
+#include <pthread.h>
+
+#define CHECK(condition) \
+    do { if (!(condition)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); return 1; } } while (0)
+
+#define THREADS 4
+#define MARKS_PER_THREAD 16000
+
+static StartupEvent events[GTSPS_TIMELINE_CAPACITY];
+
+static void* Record(void* arg)
+{
+    (void)arg;
+    for (int i = 0; i < MARKS_PER_THREAD; ++i)
+        StartupMark("mark");
+    return NULL;
+}
+
+int main(void)
+{
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; ++i)
+        CHECK(pthread_create(&threads[i], NULL, Record, NULL) == 0);
+
+    int count = 0, copies = 0;
+    while (count < THREADS * MARKS_PER_THREAD)
+    {
+        count = GetStartupTimeline(events, GTSPS_TIMELINE_CAPACITY);
+        for (int i = 0; i < count; ++i)
+            CHECK(events[i].name && events[i].type == GTSPS_EVENT_MARK && events[i].begin > 0.0 &&
+                  events[i].end == events[i].begin);
+        ++copies;
+    }
+    printf("%d events checked in %d copies\n", count, copies);
+
+    for (int i = 0; i < THREADS; ++i)
+        pthread_join(threads[i], NULL);
+    return 0;
+}
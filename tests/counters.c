@@ -0,0 +1,55 @@
+/* Copyright 2024 Max Liani
+   SPDX-License-Identifier: MIT
+
+   Checks the resource usage of spans: a span computing accounts CPU time, a span
+   sleeping accounts context switches. The hardware counters are checked where the
+   host exposes them.
+*/
+
+#define GTSPS_ENABLE_PERF_COUNTERS
+#define GTSPS_IMPLEMENTATION
+#include "GetTimeSinceProcessStart.h"
+#include <time.h>
+
+#define CHECK(condition) \
+    do { if (!(condition)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); return 1; } } while (0)
+
+int main(void)
+{
+    int compute = StartupSpanBegin("compute");
+    volatile double sum = 0.0;
+    double begin = GetTimeSinceProcessStart();
+    while (GetTimeSinceProcessStart() - begin < 0.02)
+        for (int i = 0; i < 10000; ++i)
+            sum += i;
+    StartupSpanEnd(compute);
+
+    int sleep = StartupSpanBegin("sleep");
+    for (int i = 0; i < 3; ++i)
+    {
+        struct timespec time = { 0, 2000000 };
+        nanosleep(&time, NULL);
+    }
+    StartupSpanEnd(sleep);
+
+    StartupEvent events[2];
+    CHECK(GetStartupTimeline(events, 2) == 2);
+    const StartupCounters* computed = &events[0].counters;
+    const StartupCounters* slept = &events[1].counters;
+    printf("compute: cpu %llu ns, %llu switches, %llu instructions, %llu cycles\n",
+           (unsigned long long)computed->taskClock, (unsigned long long)computed->contextSwitches,
+           (unsigned long long)computed->instructions, (unsigned long long)computed->cycles);
+    printf("sleep: cpu %llu ns, %llu switches\n", (unsigned long long)slept->taskClock,
+           (unsigned long long)slept->contextSwitches);
+
+    // The clock of the CPU time ticks in microseconds at worst
+    CHECK(computed->taskClock >= 10000000ull);
+    CHECK(slept->contextSwitches >= 3);
+    CHECK(slept->taskClock < computed->taskClock);
+
+    if (computed->instructions == 0)
+        printf("hardware counters not available, not checked\n");
+    else
+        CHECK(computed->cycles > 0 && computed->instructions > computed->cycles / 100);
+    return 0;
+}
@@ -0,0 +1,41 @@
+/* Copyright 2024 Max Liani
+   SPDX-License-Identifier: MIT
+
+   A release build with every feature enabled and the instrumentation compiled out:
+   check_disabled_release.cmake verifies that only the symbols of
+   GetTimeSinceProcessStart() are left,  and no static constructor.
+*/
+
+#define GTSPS_ENABLE_PERF_COUNTERS
+#define GTSPS_ENABLE_OFFLINE_TOOLS
+#define GTSPS_ENABLE_LIVE_RING
+#define GTSPS_ENABLE_INIT_MEMORY
+#define GTSPS_ENABLE_FAST_EXIT
+#define GTSPS_ENABLE_ASYNC_IO
+#define GTSPS_ENABLE_ZYGOTE
+#define GTSPS_ENABLE_LAUNCHER
+#define GTSPS_ENABLE_HUGE_TEXT
+#define GTSPS_DISABLE_INSTRUMENTATION
+#define GTSPS_IMPLEMENTATION
+#include "GetTimeSinceProcessStart.h"
+
+// Expands to nothing, the call to puts() goes to the C library
+GTSPS_HOOK_FUNCTION(int, puts, (const char* text), (text))
+
+int main(void)
+{
+    int span = StartupSpanBegin("load");
+    int counter = StartupProgressCreate("items", 10);
+    StartupProgressAdd(counter, 10);
+    StartupMark("loaded");
+    StartupSpanEnd(span);
+    StartupReady();
+
+    StartupEvent events[4];
+    if (GetStartupTimeline(events, 4) != 0 || SaveStartupTimeline("disabled_release.txt"))
+        return 1;
+    PrintStartupTimeline(stdout);
+    puts("ready");
+    printf("%f\n", GetTimeSinceProcessStart());
+    return 0;
+}
@@ -0,0 +1,15 @@
+/* Copyright 2024 Max Liani
+   SPDX-License-Identifier: MIT
+
+   The same program as disabled_release.c without the library, the reference of the
+   static constructors the toolchain adds on its own.
+*/
+
+#include <stdio.h>
+
+int main(void)
+{
+    puts("ready");
+    printf("%f\n", 0.0);
+    return 0;
+}
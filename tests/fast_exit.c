@@ -0,0 +1,109 @@
+/* Copyright 2024 Max Liani
+   SPDX-License-Identifier: MIT
+
+   Runs StartupFastExit() in a child writing to a pipe, and checks the order of the
+   output: the output buffered before the call, the flush handlers in the reverse
+   order of registration, then nothing of the teardown, atexit() handlers and static
+   destructors. With GTSPS_FAST_EXIT_VALIDATE=1 the teardown runs after the handlers,
+   and is reported.
+*/
+
+#define GTSPS_ENABLE_FAST_EXIT
+#define GTSPS_IMPLEMENTATION
+#include "GetTimeSinceProcessStart.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define CHECK(condition) \
+    do { if (!(condition)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); return 1; } } while (0)
+
+static int exiting;
+
+static void Flush(void* userData)
+{
+    printf("%s\n", (const char*)userData);
+}
+
+static void AtExit(void)
+{
+    printf("atexit\n");
+}
+
+__attribute__((destructor)) static void Destructor(void)
+{
+    if (exiting)
+        printf("destructor\n");
+}
+
+// @brief  Runs the test executable itself to exit fast, with stdout and stderr in
+//         the buffers.
+//
+// @return the exit code, -1 in case of error.
+static int RunFastExit(const char* executable, const char* validate, char* out, char* err, size_t size)
+{
+    int outPipe[2], errPipe[2];
+    if (pipe(outPipe) != 0 || pipe(errPipe) != 0)
+        return -1;
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        dup2(outPipe[1], STDOUT_FILENO);
+        dup2(errPipe[1], STDERR_FILENO);
+        close(outPipe[0]);
+        close(outPipe[1]);
+        close(errPipe[0]);
+        close(errPipe[1]);
+        if (validate)
+            setenv("GTSPS_FAST_EXIT_VALIDATE", validate, 1);
+        execl(executable, executable, "--exit", (char*)NULL);
+        _exit(127);
+    }
+    close(outPipe[1]);
+    close(errPipe[1]);
+
+    // The output is small, it fits in the pipes until the child exits
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status))
+        return -1;
+    ssize_t outSize = read(outPipe[0], out, size - 1);
+    ssize_t errSize = read(errPipe[0], err, size - 1);
+    out[outSize > 0 ? outSize : 0] = '\0';
+    err[errSize > 0 ? errSize : 0] = '\0';
+    close(outPipe[0]);
+    close(errPipe[0]);
+    return WEXITSTATUS(status);
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "--exit") == 0)
+    {
+        exiting = 1;
+        atexit(AtExit);
+        StartupRegisterFlushHandler(Flush, (void*)"first registered");
+        StartupRegisterFlushHandler(Flush, (void*)"second registered");
+        printf("buffered\n");
+        StartupFastExit(3);
+    }
+
+    char executable[4096];
+    ssize_t length = readlink("/proc/self/exe", executable, sizeof(executable) - 1);
+    CHECK(length > 0);
+    executable[length] = '\0';
+
+    char out[4096], err[4096];
+    CHECK(RunFastExit(executable, NULL, out, err, sizeof(out)) == 3);
+    printf("fast exit:\n%s", out);
+    CHECK(strcmp(out, "buffered\nsecond registered\nfirst registered\n") == 0);
+    CHECK(!strstr(err, "Fast exit validation"));
+
+    // The teardown the fast exit skips runs after the flush, and is timed
+    CHECK(RunFastExit(executable, "1", out, err, sizeof(out)) == 3);
+    printf("validated:\n%s%s", out, err);
+    const char* handlers = strstr(out, "buffered\nsecond registered\nfirst registered\n");
+    CHECK(handlers == out && strstr(out, "atexit") && strstr(out, "destructor"));
+    CHECK(strstr(err, "Fast exit validation: the teardown took"));
+    return 0;
+}
@@ -0,0 +1,88 @@
+/* Copyright 2024 Max Liani
+   SPDX-License-Identifier: MIT
+
+   Releases the init-only memory with the instrumentation compiled out: StartupReady()
+   reclaims the pages of a zero initialized array touched during the startup, and the
+   array takes no space in the executable file.
+*/
+
+#define GTSPS_ENABLE_INIT_MEMORY
+#define GTSPS_DISABLE_INSTRUMENTATION
+#define GTSPS_IMPLEMENTATION
+#include "GetTimeSinceProcessStart.h"
+#include <string.h>
+#include <link.h>
+
+#define CHECK(condition) \
+    do { if (!(condition)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); return 1; } } while (0)
+
+#define SCRATCH_SIZE (8 << 20)
+
+GTSPS_INIT_ONLY_BSS static char scratch[SCRATCH_SIZE];
+
+static size_t ResidentSize(void)
+{
+    unsigned long pages = 0;
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (file)
+    {
+        if (fscanf(file, "%*u %lu", &pages) != 1)
+            pages = 0;
+        fclose(file);
+    }
+    return (size_t)pages * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+// @brief  Finds the type of a section in the executable file.
+//
+// @return the section type, SHT_NULL if not found.
+static unsigned SectionType(const char* name)
+{
+    unsigned type = SHT_NULL;
+    FILE* file = fopen("/proc/self/exe", "rb");
+    ElfW(Ehdr) header;
+    if (!file || fread(&header, sizeof(header), 1, file) != 1 || header.e_shentsize != sizeof(ElfW(Shdr)))
+    {
+        if (file)
+            fclose(file);
+        return type;
+    }
+
+    ElfW(Shdr)* sections = (ElfW(Shdr)*)calloc(header.e_shnum, sizeof(ElfW(Shdr)));
+    char* names = NULL;
+    if (sections && fseek(file, (long)header.e_shoff, SEEK_SET) == 0 &&
+        fread(sections, sizeof(ElfW(Shdr)), header.e_shnum, file) == header.e_shnum &&
+        header.e_shstrndx < header.e_shnum)
+    {
+        const ElfW(Shdr)* table = &sections[header.e_shstrndx];
+        names = (char*)calloc(table->sh_size + 1, 1);
+        if (names && fseek(file, (long)table->sh_offset, SEEK_SET) == 0 &&
+            fread(names, 1, table->sh_size, file) == table->sh_size)
+        {
+            for (unsigned i = 0; i < header.e_shnum; ++i)
+                if (sections[i].sh_name < table->sh_size && strcmp(names + sections[i].sh_name, name) == 0)
+                    type = sections[i].sh_type;
+        }
+    }
+    free(names);
+    free(sections);
+    fclose(file);
+    return type;
+}
+
+int main(void)
+{
+    CHECK(SectionType("gtsps_init_bss") == SHT_NOBITS);
+
+    memset(scratch, 1, sizeof(scratch));
+    size_t before = ResidentSize();
+    StartupReady();
+    size_t after = ResidentSize();
+    printf("resident before %zu, after %zu bytes\n", before, after);
+
+    // Only the pages fully inside the section are released
+    CHECK(before > after && before - after >= SCRATCH_SIZE / 2);
+    // The released pages read back as zeros
+    CHECK(((volatile char*)scratch)[SCRATCH_SIZE / 2] == 0);
+    return 0;
+}
@@ -0,0 +1,92 @@
+/* Copyright 2024 Max Liani
+   SPDX-License-Identifier: MIT
+
+   Launches the test executable itself, by path and through a PATH listing many
+   missing directories first, and checks that the execve phase only covers the call
+   that succeeds: the failed attempts count in the pre-exec phase. Skipped when
+   ptrace is denied.
+*/
+
+#define GTSPS_ENABLE_LAUNCHER
+#define GTSPS_IMPLEMENTATION
+#include "GetTimeSinceProcessStart.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CHECK(condition) \
+    do { if (!(condition)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); return 1; } } while (0)
+
+#define RUNS 9
+#define MISSING_DIRECTORIES 200
+
+static int CompareDoubles(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+static double Median(double* values)
+{
+    qsort(values, RUNS, sizeof(double), CompareDoubles);
+    return values[RUNS / 2];
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "--exit") == 0)
+        return 0;
+
+    char executable[4096];
+    ssize_t length = readlink("/proc/self/exe", executable, sizeof(executable) - 1);
+    CHECK(length > 0);
+    executable[length] = '\0';
+    char* name = strrchr(executable, '/');
+    CHECK(name);
+
+    // The directories that don't exist come first in PATH
+    static char path[MISSING_DIRECTORIES * 32 + 4096];
+    size_t size = 0;
+    for (int i = 0; i < MISSING_DIRECTORIES; ++i)
+        size += (size_t)snprintf(path + size, sizeof(path) - size, "/gtsps_missing_%d:", i);
+    snprintf(path + size, sizeof(path) - size, "%.*s", (int)(name - executable), executable);
+
+    char* direct[] = { executable, (char*)"--exit", NULL };
+    char* searched[] = { name + 1, (char*)"--exit", NULL };
+    char* previousPath = getenv("PATH") ? strdup(getenv("PATH")) : NULL;
+
+    StartupExecPhases phases;
+    if (!StartupLaunch(direct, &phases))
+        return 77;
+    CHECK(phases.exitStatus == 0 && phases.exec > 0.0 && phases.total >= phases.exec);
+
+    double directExec[RUNS], directPreExec[RUNS], searchedExec[RUNS], searchedPreExec[RUNS];
+    for (int run = 0; run < RUNS; ++run)
+    {
+        CHECK(StartupLaunch(direct, &phases) && phases.exitStatus == 0);
+        directExec[run] = phases.exec;
+        directPreExec[run] = phases.preExec;
+
+        setenv("PATH", path, 1);
+        int launched = StartupLaunch(searched, &phases);
+        if (previousPath)
+            setenv("PATH", previousPath, 1);
+        else
+            unsetenv("PATH");
+        CHECK(launched && phases.exitStatus == 0);
+        searchedExec[run] = phases.exec;
+        searchedPreExec[run] = phases.preExec;
+    }
+    free(previousPath);
+
+    double exec = Median(directExec), preExec = Median(directPreExec);
+    double execInPath = Median(searchedExec), preExecInPath = Median(searchedPreExec);
+    printf("direct: pre-exec %.6f exec %.6f, in PATH: pre-exec %.6f exec %.6f\n", preExec, exec, preExecInPath,
+           execInPath);
+
+    // The failed attempts make the pre-exec phase longer, not the execve phase
+    double attempts = preExecInPath - preExec;
+    CHECK(attempts > 0.0);
+    CHECK(execInPath - exec < attempts * 0.5);
+    return 0;
+}
@@ -0,0 +1,122 @@
+/* Copyright 2024 Max Liani
+   SPDX-License-Identifier: MIT
+
+   Runs the test executable itself with GTSPS_LIVE_RING set, and reads the events it
+   published: the begin and end of a span with the same index and the mark in between
+   in order, the last sample of a progress counter, the events a full ring dropped,
+   and nothing from a forked child. The published process doesn't pass the variable
+   to the programs it runs.
+*/
+
+#define GTSPS_LIVE_RING_CAPACITY 64
+#define GTSPS_ENABLE_LIVE_RING
+#define GTSPS_IMPLEMENTATION
+#include "GetTimeSinceProcessStart.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define CHECK(condition) \
+    do { if (!(condition)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); return 1; } } while (0)
+
+#define FLOOD_MARKS 100
+
+static void* Flood(void* arg)
+{
+    (void)arg;
+    for (int i = 0; i < FLOOD_MARKS; ++i)
+        StartupMark("flood");
+    return NULL;
+}
+
+// @brief  The process publishing the events, its exit code tells the checks it failed.
+static int Publish(void)
+{
+    CHECK(!getenv("GTSPS_LIVE_RING"));
+
+    int load = StartupSpanBegin("load");
+    int items = StartupProgressCreate("items", 10);
+    StartupMark("parsed");
+    StartupProgressAdd(items, 7);
+    StartupSpanEnd(load);
+
+    // Nobody reads while the thread publishes, its ring fills up
+    pthread_t thread;
+    CHECK(pthread_create(&thread, NULL, Flood, NULL) == 0);
+    pthread_join(thread, NULL);
+
+    pid_t child = fork();
+    if (child == 0)
+    {
+        StartupMark("in child");
+        _exit(0);
+    }
+    int status = 0;
+    CHECK(child > 0 && waitpid(child, &status, 0) == child);
+    return 0;
+}
+
+static int Find(const StartupLiveEvent* events, int count, int type, const char* name)
+{
+    for (int i = 0; i < count; ++i)
+        if (events[i].type == type && strcmp(events[i].name, name) == 0)
+            return i;
+    return -1;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "--publish") == 0)
+        return Publish();
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/gtsps_live_ring_%d.live", (int)getpid());
+    pid_t pid = fork();
+    CHECK(pid >= 0);
+    if (pid == 0)
+    {
+        setenv("GTSPS_LIVE_RING", path, 1);
+        execl("/proc/self/exe", argv[0], "--publish", (char*)NULL);
+        _exit(127);
+    }
+    int status = 0;
+    CHECK(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    // The events stay in the file once the process exited
+    StartupLiveReader reader;
+    CHECK(OpenStartupLiveRing(path, &reader));
+    CHECK(reader.pid == pid);
+    static StartupLiveEvent events[4096];
+    int count = PollStartupLiveRing(&reader, events, 4096);
+
+    int begin = Find(events, count, GTSPS_LIVE_BEGIN, "load");
+    int mark = Find(events, count, GTSPS_LIVE_MARK, "parsed");
+    int end = Find(events, count, GTSPS_LIVE_END, "load");
+    CHECK(begin >= 0 && begin < mark && mark < end);
+    CHECK(events[begin].span == events[end].span && events[begin].thread == events[end].thread);
+    CHECK(events[end].time >= events[begin].time);
+
+    // The counter takes its last sample on the thread that ends its span
+    int progress = -1;
+    for (int i = 0; i < count; ++i)
+        if (events[i].type == GTSPS_LIVE_PROGRESS && events[i].thread == events[end].thread &&
+            strcmp(events[i].name, "items") == 0)
+            progress = i;
+    CHECK(progress > end && events[progress].value == 7 && events[progress].total == 10);
+    CHECK(events[progress].span == events[begin].span);
+
+    int flooded = 0;
+    for (int i = 0; i < count; ++i)
+        flooded += events[i].type == GTSPS_LIVE_MARK && strcmp(events[i].name, "flood") == 0;
+    CHECK(flooded == GTSPS_LIVE_RING_CAPACITY);
+    CHECK(reader.dropped == FLOOD_MARKS - GTSPS_LIVE_RING_CAPACITY);
+    CHECK(Find(events, count, GTSPS_LIVE_MARK, "in child") < 0);
+
+    // The events were consumed
+    CHECK(PollStartupLiveRing(&reader, events, 4096) == 0);
+    CloseStartupLiveRing(&reader);
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,55 @@
+/* Copyright 2024 Max Liani
+   SPDX-License-Identifier: MIT
+
+   Checks that GetTimeSinceProcessStart() doesn't allocate: it may run in static
+   constructors, before the allocator of the program is ready.  The executable
+   interposes the glibc allocation functions and counts the calls made during the
+   first measurement.
+*/
+
+#define GTSPS_IMPLEMENTATION
+#include "GetTimeSinceProcessStart.h"
+
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* address, size_t size);
+
+static int counting;
+static int allocations;
+
+void* malloc(size_t size)
+{
+    allocations += counting;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+    allocations += counting;
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* address, size_t size)
+{
+    allocations += counting;
+    return __libc_realloc(address, size);
+}
+
+static double timeInConstructor;
+
+__attribute__((constructor)) static void MeasureInConstructor(void)
+{
+    counting = 1;
+    timeInConstructor = GetTimeSinceProcessStart();
+    counting = 0;
+}
+
+int main(void)
+{
+    if (timeInConstructor <= 0.0 || allocations != 0)
+    {
+        fprintf(stderr, "GetTimeSinceProcessStart() returned %f after %d allocations\n", timeInConstructor, allocations);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,277 @@
+/* Copyright 2024 Max Liani
+   SPDX-License-Identifier: MIT
+
+   Saves the spans as a pprof profile and decodes it with a minimal protobuf reader:
+   the value types, one sample per closed span with the stack of the enclosing spans
+   and its own wall time excluding the nested spans, the thread label, the time range,
+   and on Linux the span named by a code address as a location in a mapping of the
+   executable.
+*/
+
+#define GTSPS_IMPLEMENTATION
+#include "GetTimeSinceProcessStart.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK(condition) \
+    do { if (!(condition)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); return 1; } } while (0)
+
+#define PROFILE_PATH "pprof_test.pb"
+#define MAX_ITEMS 64
+
+typedef struct Bytes
+{
+    const uint8_t* data;
+    size_t         size;
+} Bytes;
+
+// A field of a message: a varint, or bytes for the length delimited fields.
+typedef struct Field
+{
+    int      number;
+    uint64_t value;
+    Bytes    bytes;
+} Field;
+
+static int ReadVarint(Bytes* in, uint64_t* value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 64 && in->size > 0; shift += 7)
+    {
+        uint8_t byte = *in->data++;
+        --in->size;
+        *value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return 1;
+    }
+    return 0;
+}
+
+// @brief  Reads the next field of a message, only varints and length delimited fields
+//         are expected.
+//
+// @return 1 if a field was read, 0 at the end, -1 if the message is malformed.
+static int NextField(Bytes* in, Field* field)
+{
+    uint64_t key;
+    if (in->size == 0)
+        return 0;
+    if (!ReadVarint(in, &key))
+        return -1;
+    field->number = (int)(key >> 3);
+    if ((key & 7) == 0)
+        return ReadVarint(in, &field->value) ? 1 : -1;
+    if ((key & 7) != 2 || !ReadVarint(in, &field->value) || field->value > in->size)
+        return -1;
+    field->bytes.data = in->data;
+    field->bytes.size = (size_t)field->value;
+    in->data += field->value;
+    in->size -= (size_t)field->value;
+    return 1;
+}
+
+// @brief  Reads a varint field of a message, e.g. an id.
+//
+// @return the value, 0 if the field is absent.
+static uint64_t VarintField(Bytes message, int number)
+{
+    Field field;
+    uint64_t value = 0;
+    while (NextField(&message, &field) == 1)
+        if (field.number == number)
+            value = field.value;
+    return value;
+}
+
+// @brief  Reads a packed repeated varint field.
+//
+// @return the number of values.
+static int PackedField(Bytes message, int number, uint64_t* values, int capacity)
+{
+    Field field;
+    int count = 0;
+    while (NextField(&message, &field) == 1)
+    {
+        if (field.number != number)
+            continue;
+        while (field.bytes.size > 0 && count < capacity && ReadVarint(&field.bytes, &values[count]))
+            ++count;
+    }
+    return count;
+}
+
+typedef struct Profile
+{
+    Bytes    strings[MAX_ITEMS];
+    int      stringCount;
+    Bytes    sampleTypes[MAX_ITEMS];
+    int      sampleTypeCount;
+    Bytes    samples[MAX_ITEMS];
+    int      sampleCount;
+    Bytes    locations[MAX_ITEMS];
+    int      locationCount;
+    Bytes    functions[MAX_ITEMS];
+    int      functionCount;
+    Bytes    mappings[MAX_ITEMS];
+    int      mappingCount;
+    uint64_t timeNanos;
+    uint64_t durationNanos;
+    uint64_t period;
+} Profile;
+
+static int Decode(Bytes in, Profile* profile)
+{
+    memset(profile, 0, sizeof(*profile));
+    Field field;
+    int result;
+    while ((result = NextField(&in, &field)) == 1)
+    {
+        Bytes* items = NULL;
+        int* count = NULL;
+        switch (field.number)
+        {
+        case 1: items = profile->sampleTypes; count = &profile->sampleTypeCount; break;
+        case 2: items = profile->samples; count = &profile->sampleCount; break;
+        case 3: items = profile->mappings; count = &profile->mappingCount; break;
+        case 4: items = profile->locations; count = &profile->locationCount; break;
+        case 5: items = profile->functions; count = &profile->functionCount; break;
+        case 6: items = profile->strings; count = &profile->stringCount; break;
+        case 9: profile->timeNanos = field.value; break;
+        case 10: profile->durationNanos = field.value; break;
+        case 12: profile->period = field.value; break;
+        default: break;
+        }
+        if (items && *count < MAX_ITEMS)
+            items[(*count)++] = field.bytes;
+    }
+    return result == 0;
+}
+
+static int IsString(const Profile* profile, uint64_t index, const char* text)
+{
+    return index < (uint64_t)profile->stringCount && profile->strings[index].size == strlen(text) &&
+           memcmp(profile->strings[index].data, text, strlen(text)) == 0;
+}
+
+static const Bytes* FindById(const Bytes* items, int count, uint64_t id)
+{
+    for (int i = 0; i < count; ++i)
+        if (VarintField(items[i], 1) == id)
+            return &items[i];
+    return NULL;
+}
+
+// @brief  Resolves the name of a location through its line and function.
+//
+// @return the string index of the name, 0 if the location has no function.
+static uint64_t LocationName(const Profile* profile, uint64_t locationId)
+{
+    const Bytes* location = FindById(profile->locations, profile->locationCount, locationId);
+    if (!location)
+        return 0;
+    Bytes message = *location;
+    Field field;
+    while (NextField(&message, &field) == 1)
+    {
+        if (field.number != 4)
+            continue;
+        const Bytes* function = FindById(profile->functions, profile->functionCount, VarintField(field.bytes, 1));
+        return function ? VarintField(*function, 2) : 0;
+    }
+    return 0;
+}
+
+// @brief  Finds the sample whose leaf location is named so.
+static const Bytes* FindSample(const Profile* profile, const char* name)
+{
+    for (int i = 0; i < profile->sampleCount; ++i)
+    {
+        uint64_t stack[MAX_ITEMS];
+        if (PackedField(profile->samples[i], 1, stack, MAX_ITEMS) > 0 &&
+            IsString(profile, LocationName(profile, stack[0]), name))
+            return &profile->samples[i];
+    }
+    return NULL;
+}
+
+static void Spin(double seconds)
+{
+    volatile double sum = 0.0;
+    double begin = GetTimeSinceProcessStart();
+    while (GetTimeSinceProcessStart() - begin < seconds)
+        for (int i = 0; i < 1000; ++i)
+            sum += i;
+}
+
+int main(void)
+{
+    // outer: 20 ms of its own and 10 ms in inner
+    int outer = StartupSpanBegin("outer");
+    Spin(0.02);
+    int inner = StartupSpanBegin("inner");
+    Spin(0.01);
+    StartupSpanEnd(inner);
+    StartupSpanEnd(outer);
+    StartupMark("not a sample");
+    int code = StartupSpanBeginAt((const void*)main);
+    StartupSpanEnd(code);
+    StartupSpanBegin("still open");
+
+    remove(PROFILE_PATH);
+    CHECK(SaveStartupProfile(PROFILE_PATH));
+    FILE* file = fopen(PROFILE_PATH, "rb");
+    CHECK(file);
+    static uint8_t data[1 << 20];
+    size_t size = fread(data, 1, sizeof(data), file);
+    fclose(file);
+    remove(PROFILE_PATH);
+
+    Profile profile;
+    Bytes in = { data, size };
+    CHECK(size > 0 && size < sizeof(data) && Decode(in, &profile));
+    CHECK(profile.stringCount > 0 && profile.strings[0].size == 0);
+
+    // The value types, wall time first
+    CHECK(profile.sampleTypeCount == 7);
+    CHECK(IsString(&profile, VarintField(profile.sampleTypes[0], 1), "wall"));
+    CHECK(IsString(&profile, VarintField(profile.sampleTypes[0], 2), "nanoseconds"));
+    CHECK(IsString(&profile, VarintField(profile.sampleTypes[1], 1), "cpu"));
+
+    // A sample per closed span, the mark and the open span are not
+    CHECK(profile.sampleCount == 3);
+    const Bytes* innerSample = FindSample(&profile, "inner");
+    const Bytes* outerSample = FindSample(&profile, "outer");
+    CHECK(innerSample && outerSample);
+
+    uint64_t stack[MAX_ITEMS], values[MAX_ITEMS];
+    CHECK(PackedField(*innerSample, 1, stack, MAX_ITEMS) == 2);
+    CHECK(IsString(&profile, LocationName(&profile, stack[1]), "outer"));
+    CHECK(PackedField(*innerSample, 2, values, MAX_ITEMS) == 7);
+    CHECK(values[0] >= 10000000 && values[0] < 20000000);
+    CHECK(PackedField(*outerSample, 2, values, MAX_ITEMS) == 7);
+    CHECK(values[0] >= 20000000 && values[0] < 30000000);
+
+    // The thread label
+    Bytes sample = *outerSample;
+    Field field;
+    int labels = 0;
+    while (NextField(&sample, &field) == 1)
+        if (field.number == 3)
+            labels += IsString(&profile, VarintField(field.bytes, 1), "thread") && VarintField(field.bytes, 3) != 0;
+    CHECK(labels == 1);
+
+    CHECK(profile.timeNanos > 0 && profile.durationNanos >= 30000000 && profile.period == 1);
+
+#if defined(linux) || defined(__linux__) || defined(__LINUX__)
+    // The span named by address is left to symbolize, in the mapping of the executable
+    CHECK(profile.mappingCount == 1);
+    uint64_t start = VarintField(profile.mappings[0], 2), limit = VarintField(profile.mappings[0], 3);
+    CHECK(start <= (uint64_t)(uintptr_t)main && (uint64_t)(uintptr_t)main < limit);
+    int addressed = 0;
+    for (int i = 0; i < profile.locationCount; ++i)
+        addressed += VarintField(profile.locations[i], 2) == VarintField(profile.mappings[0], 1) &&
+                     VarintField(profile.locations[i], 3) == (uint64_t)(uintptr_t)main;
+    CHECK(addressed == 1);
+#endif
+    return 0;
+}
@@ -0,0 +1,91 @@
+/* Copyright 2024 Max Liani
+   SPDX-License-Identifier: MIT
+
+   Checks when the progress counters stop being sampled: a counter tied to a span
+   takes its last sample when the span ends, and the sampler thread exits with no
+   counter left. A new counter starts the thread again, until the time limit of
+   GTSPS_PROGRESS_MAX_MS.
+*/
+
+#define GTSPS_PROGRESS_PERIOD_MS 20
+#define GTSPS_PROGRESS_MAX_MS 1500
+#define GTSPS_IMPLEMENTATION
+#include "GetTimeSinceProcessStart.h"
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+
+#define CHECK(condition) \
+    do { if (!(condition)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); return 1; } } while (0)
+
+static void Sleep(int milliseconds)
+{
+    struct timespec time = { milliseconds / 1000, (milliseconds % 1000) * 1000000L };
+    nanosleep(&time, NULL);
+}
+
+static int CountThreads(void)
+{
+    int count = 0;
+    DIR* directory = opendir("/proc/self/task");
+    if (!directory)
+        return -1;
+    for (struct dirent* entry = readdir(directory); entry; entry = readdir(directory))
+        count += entry->d_name[0] != '.';
+    closedir(directory);
+    return count;
+}
+
+// @brief  Waits up to a second for the process to run the given number of threads.
+static int WaitForThreads(int count)
+{
+    for (int attempt = 0; attempt < 100 && CountThreads() != count; ++attempt)
+        Sleep(10);
+    return CountThreads() == count;
+}
+
+static void Report(char* text, size_t size)
+{
+    FILE* out = tmpfile();
+    text[0] = '\0';
+    if (!out)
+        return;
+    PrintStartupProgress(out);
+    rewind(out);
+    size_t length = fread(text, 1, size - 1, out);
+    text[length] = '\0';
+    fclose(out);
+    fputs(text, stdout);
+}
+
+int main(void)
+{
+    char text[8192];
+    CHECK(CountThreads() == 1);
+
+    // The counter is sampled while its span is open, and keeps the value at its end
+    int span = StartupSpanBegin("load");
+    int items = StartupProgressCreate("items", 0);
+    CHECK(items >= 0 && CountThreads() == 2);
+    StartupProgressAdd(items, 10);
+    Sleep(100);
+    StartupSpanEnd(span);
+    StartupProgressAdd(items, 5);
+    CHECK(WaitForThreads(1));
+    Report(text, sizeof(text));
+    CHECK(strstr(text, "Progress \"items\" in \"load\": 10 at"));
+
+    // A new counter starts the sampler again, which stops at the time limit
+    int late = StartupProgressCreate("late", 0);
+    CHECK(late >= 0 && CountThreads() == 2);
+    StartupProgressAdd(late, 3);
+    while (GetTimeSinceProcessStart() < GTSPS_PROGRESS_MAX_MS / 1000.0)
+        Sleep(50);
+    CHECK(WaitForThreads(1));
+    StartupProgressAdd(late, 4);
+    Report(text, sizeof(text));
+    CHECK(strstr(text, "Progress \"late\": 3 at"));
+
+    StartupReady();
+    return 0;
+}
@@ -0,0 +1,220 @@
+/* Copyright 2024 Max Liani
+   SPDX-License-Identifier: MIT
+
+   Round-trips the timeline through the text file and the binary records, of two
+   processes appended to the same file,  and checks that corrupt records files are
+   rejected: a bad magic or version, a truncated or misaligned record, a name not
+   terminated inside its record, an impossible event count and a parent that doesn't
+   precede its child.
+*/
+
+#define GTSPS_IMPLEMENTATION
+#include "GetTimeSinceProcessStart.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK(condition) \
+    do { if (!(condition)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); return 1; } } while (0)
+
+#define RECORDS_PATH "records_test.bin"
+#define CORRUPT_PATH "records_test_corrupt.bin"
+#define TEXT_PATH    "records_test.txt"
+
+static char* ReadFile(const char* path, size_t* size)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return NULL;
+    fseek(file, 0, SEEK_END);
+    *size = (size_t)ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* data = (char*)malloc(*size);
+    if (data && fread(data, 1, *size, file) != *size)
+    {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    return data;
+}
+
+static int WriteFile(const char* path, const char* data, size_t size)
+{
+    FILE* file = fopen(path, "wb");
+    if (!file)
+        return 0;
+    size_t written = fwrite(data, 1, size, file);
+    return fclose(file) == 0 && written == size;
+}
+
+// @brief  Finds the offset of the first record of a type, walking the headers.
+//
+// @return the offset, 0 if not found.
+static size_t FindRecord(const char* data, size_t size, int type)
+{
+    for (size_t offset = 16; offset + sizeof(StartupRecordHeader) <= size;)
+    {
+        StartupRecordHeader header;
+        memcpy(&header, data + offset, sizeof(header));
+        if (header.type == type)
+            return offset;
+        if (header.size == 0)
+            break;
+        offset += header.size;
+    }
+    return 0;
+}
+
+// @brief  Counts the records read from the file until the end or the first corrupt
+//         one.
+//
+// @return the number of records, -1 if the file is rejected when opened.
+static int CountRecords(const char* path)
+{
+    StartupRecordReader reader;
+    if (!OpenStartupRecords(path, &reader))
+        return -1;
+    StartupRecord record;
+    int count = 0;
+    while (NextStartupRecord(&reader, &record))
+        ++count;
+    CloseStartupRecords(&reader);
+    return count;
+}
+
+static int SameEvents(const StartupEvent* a, const StartupEvent* b, int count, double precision)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        if (strcmp(a[i].name, b[i].name) != 0 || a[i].type != b[i].type || a[i].parent != b[i].parent ||
+            a[i].thread != b[i].thread || a[i].begin - b[i].begin > precision || b[i].begin - a[i].begin > precision ||
+            a[i].end - b[i].end > precision || b[i].end - a[i].end > precision ||
+            a[i].counters.minorFaults != b[i].counters.minorFaults ||
+            a[i].counters.taskClock != b[i].counters.taskClock)
+            return 0;
+    }
+    return 1;
+}
+
+int main(void)
+{
+    int load = StartupSpanBegin("load");
+    int items = StartupProgressCreate("items", 10);
+    StartupMark("parsed");
+    StartupProgressAdd(items, 7);
+    int nested = StartupSpanBegin("name with spaces");
+    StartupSpanEnd(nested);
+    StartupSpanEnd(load);
+    StartupSpanBegin("still open");
+
+    StartupEvent events[8];
+    int count = GetStartupTimeline(events, 8);
+    CHECK(count == 4);
+
+    // The text file keeps the times to the nanosecond
+    StartupTimeline timeline;
+    CHECK(SaveStartupTimeline(TEXT_PATH));
+    CHECK(LoadStartupTimeline(TEXT_PATH, &timeline));
+    CHECK(timeline.count == count && SameEvents(events, timeline.events, count, 1e-9));
+    FreeStartupTimeline(&timeline);
+
+    // Two processes in one file, the timeline is loaded from the first one
+    remove(RECORDS_PATH);
+    CHECK(AppendStartupRecords(RECORDS_PATH));
+    StartupMark("appended");
+    CHECK(AppendStartupRecords(RECORDS_PATH));
+    CHECK(LoadStartupTimeline(RECORDS_PATH, &timeline));
+    CHECK(timeline.count == count && SameEvents(events, timeline.events, count, 0.0));
+    FreeStartupTimeline(&timeline);
+
+    StartupRecordReader reader;
+    StartupRecord record;
+    CHECK(OpenStartupRecords(RECORDS_PATH, &reader));
+    int processes = 0, eventRecords = 0, counterRecords = 0;
+    while (NextStartupRecord(&reader, &record))
+    {
+        if (record.type == GTSPS_RECORD_PROCESS)
+        {
+            const StartupProcessRecord* process = (const StartupProcessRecord*)record.data;
+            CHECK(process->eventCount == count + processes);
+            ++processes;
+        }
+        else if (record.type == GTSPS_RECORD_MARK || record.type == GTSPS_RECORD_SPAN)
+        {
+            const StartupEventRecord* event = (const StartupEventRecord*)record.data;
+            int index = eventRecords < count ? eventRecords : eventRecords - count;
+            CHECK(index >= count || strcmp(record.name, events[index].name) == 0);
+            CHECK(index >= count || event->parent == events[index].parent);
+            ++eventRecords;
+        }
+        else if (record.type == GTSPS_RECORD_COUNTER)
+        {
+            const StartupCounterRecord* counter = (const StartupCounterRecord*)record.data;
+            CHECK(strcmp(record.name, "items") == 0 && counter->total == 10 && counter->value <= 7);
+            ++counterRecords;
+        }
+    }
+    CloseStartupRecords(&reader);
+    CHECK(processes == 2 && eventRecords == 2 * count + 1 && counterRecords >= 2);
+
+    size_t size = 0;
+    char* data = ReadFile(RECORDS_PATH, &size);
+    CHECK(data && size > 16);
+    int recordCount = CountRecords(RECORDS_PATH);
+    char* corrupt = (char*)malloc(size);
+    CHECK(corrupt);
+
+    // Not a records file, or another version
+    memcpy(corrupt, data, size);
+    corrupt[0] = 'X';
+    CHECK(WriteFile(CORRUPT_PATH, corrupt, size) && CountRecords(CORRUPT_PATH) == -1);
+    CHECK(!LoadStartupTimeline(CORRUPT_PATH, &timeline));
+    memcpy(corrupt, data, size);
+    corrupt[8] = (char)(GTSPS_RECORDS_VERSION + 1);
+    CHECK(WriteFile(CORRUPT_PATH, corrupt, size) && CountRecords(CORRUPT_PATH) == -1);
+    CHECK(WriteFile(CORRUPT_PATH, data, 12) && CountRecords(CORRUPT_PATH) == -1);
+
+    // A write in progress: the last record is cut, the ones before it are read
+    CHECK(WriteFile(CORRUPT_PATH, data, size - 4) && CountRecords(CORRUPT_PATH) == recordCount - 1);
+
+    // A record of a size that isn't a multiple of 8 ends the reading
+    size_t span = FindRecord(data, size, GTSPS_RECORD_SPAN);
+    CHECK(span > 0);
+    StartupRecordHeader header;
+    memcpy(corrupt, data, size);
+    memcpy(&header, corrupt + span, sizeof(header));
+    header.size += 1;
+    memcpy(corrupt + span, &header, sizeof(header));
+    CHECK(WriteFile(CORRUPT_PATH, corrupt, size) && CountRecords(CORRUPT_PATH) < recordCount);
+
+    // A name that isn't terminated inside its record
+    memcpy(corrupt, data, size);
+    memcpy(&header, corrupt + span, sizeof(header));
+    memset(corrupt + span + sizeof(header) + sizeof(StartupEventRecord), 'x', header.size - sizeof(header) -
+           sizeof(StartupEventRecord));
+    CHECK(WriteFile(CORRUPT_PATH, corrupt, size) && CountRecords(CORRUPT_PATH) < recordCount);
+
+    // More events than the file can hold
+    size_t processOffset = FindRecord(data, size, GTSPS_RECORD_PROCESS);
+    StartupProcessRecord process;
+    memcpy(corrupt, data, size);
+    memcpy(&process, corrupt + processOffset + sizeof(header), sizeof(process));
+    process.eventCount = 1 << 30;
+    memcpy(corrupt + processOffset + sizeof(header), &process, sizeof(process));
+    CHECK(WriteFile(CORRUPT_PATH, corrupt, size) && !LoadStartupTimeline(CORRUPT_PATH, &timeline));
+
+    // The first span made its own parent
+    StartupEventRecord event;
+    memcpy(corrupt, data, size);
+    memcpy(&event, corrupt + span + sizeof(header), sizeof(event));
+    event.parent = 0;
+    memcpy(corrupt + span + sizeof(header), &event, sizeof(event));
+    CHECK(WriteFile(CORRUPT_PATH, corrupt, size) && !LoadStartupTimeline(CORRUPT_PATH, &timeline));
+
+    free(corrupt);
+    free(data);
+    remove(RECORDS_PATH);
+    remove(CORRUPT_PATH);
+    remove(TEXT_PATH);
+    return 0;
+}
@@ -0,0 +1,83 @@
+/* Copyright 2024 Max Liani
+   SPDX-License-Identifier: MIT
+
+   Checks the sampling decision in forked children, each deciding once under its own
+   environment: the sample rate, the launch budget shared through the token bucket
+   file, the permissions of that file, and that a launch finding the bucket locked is
+   not sampled instead of waiting.
+*/
+
+#define GTSPS_IMPLEMENTATION
+#include "GetTimeSinceProcessStart.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define CHECK(condition) \
+    do { if (!(condition)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); return 1; } } while (0)
+
+static char budgetFile[64];
+
+// @brief  Decides the sampling in a child with the given variables set.
+//
+// @return 1 if the child is sampled, 0 if not, -1 in case of error.
+static int SampledInChild(const char* rate, const char* budget)
+{
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        if (rate)
+            setenv("GTSPS_SAMPLE_RATE", rate, 1);
+        if (budget)
+            setenv("GTSPS_SAMPLE_BUDGET", budget, 1);
+        setenv("GTSPS_SAMPLE_BUDGET_FILE", budgetFile, 1);
+
+        // Waiting for the lock would hang the constructors of the program
+        alarm(5);
+        int sampled = StartupIsSampled();
+
+        // Launches that are not sampled only record marks
+        int span = StartupSpanBegin("span");
+        StartupSpanEnd(span);
+        _exit(sampled == (span >= 0) ? sampled : 2);
+    }
+
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) > 1)
+        return -1;
+    return WEXITSTATUS(status);
+}
+
+int main(void)
+{
+    snprintf(budgetFile, sizeof(budgetFile), "/tmp/gtsps_sampling_%d", (int)getpid());
+    unlink(budgetFile);
+
+    CHECK(SampledInChild(NULL, NULL) == 1);
+    CHECK(SampledInChild("1", NULL) == 1);
+    CHECK(SampledInChild("0", NULL) == 0);
+
+    // A budget of 2 launches per minute, the third one in a row is not sampled
+    CHECK(SampledInChild(NULL, "2") == 1);
+    CHECK(SampledInChild(NULL, "2") == 1);
+    CHECK(SampledInChild(NULL, "2") == 0);
+
+    struct stat info;
+    CHECK(stat(budgetFile, &info) == 0 && (info.st_mode & 0777) == 0600);
+
+    // Another launch holds the bucket
+    unlink(budgetFile);
+    int fd = open(budgetFile, O_RDWR | O_CREAT, 0600);
+    CHECK(fd >= 0 && flock(fd, LOCK_EX) == 0);
+    CHECK(SampledInChild(NULL, "60") == 0);
+    flock(fd, LOCK_UN);
+    CHECK(SampledInChild(NULL, "60") == 1);
+    close(fd);
+
+    unlink(budgetFile);
+    return 0;
+}
@@ -0,0 +1,149 @@
+/* Copyright 2024 Max Liani
+   SPDX-License-Identifier: MIT
+
+   Runs a reference executable a number of times and checks the median of the time it
+   reports against measurements taken in the same run, so the test holds on any
+   machine:
+
+   startup_harness <name> <runs> <tolerance> <slack> <delay> <reference> <program> [arguments...]
+
+   The programs print a time in seconds on stdout. The harness times each launch from
+   the fork to the exit of the child, the time the program reports can't be longer
+   than that, give or take a clock tick: on Linux the process start time has the
+   resolution of a clock tick, 10 ms. With a reference program, "-" for none, the
+   runs of the two programs alternate, and the median time of the program must exceed
+   the median of the reference by the delay in seconds, within delay * tolerance, or
+   within the slack in seconds when that is wider.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+static double Now(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double)time.tv_sec + (double)time.tv_nsec * 1e-9;
+}
+
+// @brief  Runs the program once and reads the time it prints, and the time the
+//         launch took from the fork to the exit.
+//
+// @return the time in seconds, negative in case of error.
+static double RunOnce(char* const argv[], double* launch)
+{
+    int output[2];
+    if (pipe(output) != 0)
+        return -1.0;
+
+    double begin = Now();
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        dup2(output[1], STDOUT_FILENO);
+        close(output[0]);
+        close(output[1]);
+        execv(argv[0], argv);
+        _exit(127);
+    }
+    close(output[1]);
+
+    char text[64] = "";
+    ssize_t size = pid > 0 ? read(output[0], text, sizeof(text) - 1) : -1;
+    close(output[0]);
+
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0 || size <= 0)
+        return -1.0;
+    *launch = Now() - begin;
+    text[size] = '\0';
+    return atof(text);
+}
+
+static int CompareDoubles(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+static double Median(double* values, int count)
+{
+    qsort(values, (size_t)count, sizeof(double), CompareDoubles);
+    return count % 2 ? values[count / 2] : (values[count / 2 - 1] + values[count / 2]) * 0.5;
+}
+
+// @brief  The median absolute deviation, robust to the odd slow run.
+static double Deviation(const double* values, int count, double median, double* scratch)
+{
+    for (int i = 0; i < count; ++i)
+        scratch[i] = values[i] > median ? values[i] - median : median - values[i];
+    return Median(scratch, count);
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 8)
+    {
+        fprintf(stderr, "usage: %s <name> <runs> <tolerance> <slack> <delay> <reference> <program> [arguments...]\n",
+                argv[0]);
+        return 2;
+    }
+    const char* name = argv[1];
+    int runs = atoi(argv[2]);
+    double tolerance = atof(argv[3]);
+    double slack = atof(argv[4]);
+    double delay = atof(argv[5]);
+    char* reference[] = { argv[6], NULL };
+    int hasReference = strcmp(argv[6], "-") != 0;
+    if (runs < 1)
+    {
+        fprintf(stderr, "%s: invalid number of runs\n", name);
+        return 2;
+    }
+
+    double* times = (double*)malloc(4 * (size_t)runs * sizeof(double));
+    if (!times)
+        return 2;
+    double* launches = times + runs;
+    double* referenceTimes = times + 2 * runs;
+    double* scratch = times + 3 * runs;
+    for (int run = 0; run < runs; ++run)
+    {
+        double launch = 0.0;
+        referenceTimes[run] = hasReference ? RunOnce(reference, &launch) : 0.0;
+        times[run] = RunOnce(argv + 7, &launches[run]);
+        if (times[run] < 0.0 || referenceTimes[run] < 0.0)
+        {
+            fprintf(stderr, "%s: run %d of %s failed\n", name, run, times[run] < 0.0 ? argv[7] : argv[6]);
+            free(times);
+            return 1;
+        }
+    }
+
+    double median = Median(times, runs);
+    double deviation = Deviation(times, runs, median, scratch);
+    double launch = Median(launches, runs);
+    double tick = 1.0 / (double)sysconf(_SC_CLK_TCK);
+
+    // The time since the process start is measured within the launch
+    int passed = median >= 0.0 && median <= launch + tick + slack;
+    printf("%s: median %.6f mad %.6f over %d runs, launch %.6f, clock tick %.6f: %s\n", name, median, deviation,
+           runs, launch, tick, passed ? "passed" : "FAILED");
+
+    if (hasReference)
+    {
+        double referenceMedian = Median(referenceTimes, runs);
+        double margin = delay * tolerance > slack ? delay * tolerance : slack;
+        double measured = median - referenceMedian;
+        int delayed = measured >= delay - margin && measured <= delay + margin;
+        printf("%s: %.6f over the reference median %.6f, expected %.6f, bounds [%.6f, %.6f]: %s\n", name, measured,
+               referenceMedian, delay, delay - margin, delay + margin, delayed ? "passed" : "FAILED");
+        passed = passed && delayed;
+    }
+    free(times);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,23 @@
+/* Copyright 2024 Max Liani
+   SPDX-License-Identifier: MIT
+
+   Reference executable: a static constructor takes 50 ms before main(), which the
+   time printed in main() must account for.
+*/
+
+#define GTSPS_IMPLEMENTATION
+#include "GetTimeSinceProcessStart.h"
+#include <time.h>
+
+__attribute__((constructor)) static void SlowStaticInit(void)
+{
+    struct timespec delay = { 0, 50 * 1000 * 1000 };
+    while (nanosleep(&delay, &delay) != 0)
+        ;
+}
+
+int main(void)
+{
+    printf("%.9f\n", GetTimeSinceProcessStart());
+    return 0;
+}
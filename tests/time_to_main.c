@@ -0,0 +1,14 @@
+/* Copyright 2024 Max Liani
+   SPDX-License-Identifier: MIT
+
+   Reference executable: prints the time from the process start to main().
+*/
+
+#define GTSPS_IMPLEMENTATION
+#include "GetTimeSinceProcessStart.h"
+
+int main(void)
+{
+    printf("%.9f\n", GetTimeSinceProcessStart());
+    return 0;
+}
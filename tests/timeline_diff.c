@@ -0,0 +1,83 @@
+/* Copyright 2024 Max Liani
+   SPDX-License-Identifier: MIT
+
+   Compares hand-built timelines and checks how PrintStartupTimelineDiff() matches
+   their events: by path, without confusing a name containing '/' with a nested
+   span, by occurrence among the events with the same path, and that it reports the
+   phase whose own time grew the most.
+*/
+
+#define GTSPS_ENABLE_OFFLINE_TOOLS
+#define GTSPS_IMPLEMENTATION
+#include "GetTimeSinceProcessStart.h"
+#include <string.h>
+
+#define CHECK(condition) \
+    do { if (!(condition)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); return 1; } } while (0)
+
+static StartupEvent Span(const char* name, int parent, double begin, double end)
+{
+    StartupEvent event;
+    memset(&event, 0, sizeof(event));
+    event.name = name;
+    event.type = GTSPS_EVENT_SPAN;
+    event.parent = parent;
+    event.begin = begin;
+    event.end = end;
+    return event;
+}
+
+static void Diff(StartupEvent* before, int beforeCount, StartupEvent* after, int afterCount, char* text, size_t size)
+{
+    StartupTimeline timelines[2] = { { before, beforeCount, NULL }, { after, afterCount, NULL } };
+    FILE* out = tmpfile();
+    text[0] = '\0';
+    if (!out)
+        return;
+    PrintStartupTimelineDiff(&timelines[0], &timelines[1], out);
+    rewind(out);
+    size_t length = fread(text, 1, size - 1, out);
+    text[length] = '\0';
+    fclose(out);
+    fputs(text, stdout);
+}
+
+// @brief  Counts the lines of the report starting with the status, e.g. "NEW ".
+static int CountStatus(const char* text, const char* status)
+{
+    int count = 0;
+    for (const char* line = text; line && *line; line = strchr(line, '\n') ? strchr(line, '\n') + 1 : NULL)
+        count += strncmp(line, status, strlen(status)) == 0;
+    return count;
+}
+
+int main(void)
+{
+    char text[4096];
+
+    // A span named "a/b" is not the span "b" nested in "a"
+    StartupEvent slash[1] = { Span("a/b", -1, 0.0, 1.0) };
+    StartupEvent nested[2] = { Span("a", -1, 0.0, 1.0), Span("b", 0, 0.0, 1.0) };
+    Diff(slash, 1, nested, 2, text, sizeof(text));
+    CHECK(CountStatus(text, "NEW ") == 2 && CountStatus(text, "GONE") == 1);
+
+    // Repeated phases match in order of occurrence
+    StartupEvent loadsBefore[3] = { Span("load", -1, 0.0, 1.0), Span("load", -1, 1.0, 3.0), Span("load", -1, 3.0, 6.0) };
+    StartupEvent loadsAfter[3] = { Span("load", -1, 0.0, 1.0), Span("load", -1, 1.0, 3.0), Span("load", -1, 3.0, 8.0) };
+    Diff(loadsBefore, 3, loadsAfter, 3, text, sizeof(text));
+    CHECK(CountStatus(text, "NEW ") == 0 && CountStatus(text, "GONE") == 0);
+    CHECK(strstr(text, "Largest regression: \"load\" +2.000000"));
+
+    // The regression is in the own time of the parent, its child got faster
+    StartupEvent parentBefore[2] = { Span("parent", -1, 0.0, 10.0), Span("child", 0, 0.0, 8.0) };
+    StartupEvent parentAfter[2] = { Span("parent", -1, 0.0, 10.0), Span("child", 0, 0.0, 5.0) };
+    Diff(parentBefore, 2, parentAfter, 2, text, sizeof(text));
+    CHECK(strstr(text, "Largest regression: \"parent\" +3.000000"));
+
+    // A parent recorded after its child is a corrupt input, the event becomes a root
+    StartupEvent corrupt[2] = { Span("first", 1, 0.0, 1.0), Span("second", 0, 0.0, 1.0) };
+    Diff(corrupt, 2, corrupt, 2, text, sizeof(text));
+    CHECK(CountStatus(text, "NEW ") == 0 && CountStatus(text, "GONE") == 0);
+    CHECK(strstr(text, "No phase regressed"));
+    return 0;
+}
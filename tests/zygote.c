@@ -0,0 +1,138 @@
+/* Copyright 2024 Max Liani
+   SPDX-License-Identifier: MIT
+
+   Serves workers from a zygote thread, and checks that the zygote reaps its workers
+   but not the other children of the process, and that the workers don't write the
+   output the zygote buffered before forking them.
+*/
+
+#define GTSPS_ENABLE_ZYGOTE
+#define GTSPS_IMPLEMENTATION
+#include "GetTimeSinceProcessStart.h"
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define CHECK(condition) \
+    do { if (!(condition)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); return 1; } } while (0)
+
+static char socketPath[64];
+
+static void Worker(int connection, void* userData)
+{
+    (void)userData;
+    char reply = 'w';
+    if (write(connection, &reply, 1) != 1)
+        _exit(1);
+}
+
+static void* Serve(void* arg)
+{
+    (void)arg;
+    StartupZygoteServe(socketPath, Worker, NULL);
+    return NULL;
+}
+
+static void Sleep(int milliseconds)
+{
+    struct timespec time = { 0, milliseconds * 1000000L };
+    nanosleep(&time, NULL);
+}
+
+// @brief  Runs the zygote in a thread of the process,  with stdout buffered in a
+//         pipe, and spawns two workers.
+static int RunZygote(void)
+{
+    printf("buffered by the zygote\n");
+
+    // A child of the application that exits before the workers
+    pid_t child = fork();
+    if (child == 0)
+        _exit(42);
+    CHECK(child > 0);
+
+    // The zygote thread takes SIGCHLD to interrupt accept() and reap the workers
+    pthread_t thread;
+    CHECK(pthread_create(&thread, NULL, Serve, NULL) == 0);
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGCHLD);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    int pids[2];
+    for (int i = 0; i < 2; ++i)
+    {
+        StartupZygoteWorkerInfo info;
+        int connection = -1;
+        for (int attempt = 0; attempt < 100 && connection < 0; ++attempt)
+        {
+            connection = StartupZygoteSpawn(socketPath, &info);
+            if (connection < 0)
+                Sleep(10);
+        }
+        CHECK(connection >= 0 && info.pid > 0 && info.latency >= 0.0);
+
+        char reply = 0;
+        CHECK(read(connection, &reply, 1) == 1 && reply == 'w');
+        close(connection);
+        pids[i] = info.pid;
+    }
+
+    // The workers that exited are reaped, after the next request at the latest
+    for (int i = 0; i < 2; ++i)
+    {
+        int attempts = 0;
+        while (kill(pids[i], 0) == 0 && attempts++ < 200)
+        {
+            StartupZygoteWorkerInfo info;
+            int connection = StartupZygoteSpawn(socketPath, &info);
+            if (connection >= 0)
+                close(connection);
+            Sleep(10);
+        }
+        CHECK(kill(pids[i], 0) != 0);
+    }
+
+    // The child of the application is left to it
+    int status = 0;
+    CHECK(waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 42);
+    return 0;
+}
+
+int main(void)
+{
+    snprintf(socketPath, sizeof(socketPath), "/tmp/gtsps_zygote_%d.sock", (int)getpid());
+
+    int output[2];
+    CHECK(pipe(output) == 0);
+    pid_t pid = fork();
+    CHECK(pid >= 0);
+    if (pid == 0)
+    {
+        dup2(output[1], STDOUT_FILENO);
+        close(output[0]);
+        close(output[1]);
+        exit(RunZygote());
+    }
+    close(output[1]);
+
+    char text[4096];
+    size_t size = 0;
+    ssize_t bytesRead;
+    while (size < sizeof(text) - 1 && (bytesRead = read(output[0], text + size, sizeof(text) - 1 - size)) > 0)
+        size += (size_t)bytesRead;
+    text[size] = '\0';
+    close(output[0]);
+
+    int status = 0;
+    CHECK(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    unlink(socketPath);
+
+    // Written once, by the zygote process
+    const char* first = strstr(text, "buffered by the zygote");
+    CHECK(first && !strstr(first + 1, "buffered by the zygote"));
+    return 0;
+}